@@ -1,40 +1,4004 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
 #include <iostream>
-#include <type_traits>
 #include <limits>
+#include <locale>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__has_include)
+#   if __has_include(<format>)
+#       include <format>
+#   endif
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#   include <x86intrin.h>
+#endif
+
+// Static tracepoints (USDT) are compiled in when systemtap's <sys/sdt.h> is available. An inactive
+//  probe costs a single nop. Define INTEGRAL_IO_DISABLE_USDT to leave them out entirely.
+// They can be listed with e.g. `bpftrace -l 'usdt:./program:integral_io:*'`.
+#if !defined(INTEGRAL_IO_DISABLE_USDT) && defined(__has_include)
+#   if __has_include(<sys/sdt.h>)
+#       include <sys/sdt.h>
+#       define INTEGRAL_IO_PROBE1(name, a1) DTRACE_PROBE1(integral_io, name, a1)
+#       define INTEGRAL_IO_PROBE2(name, a1, a2) DTRACE_PROBE2(integral_io, name, a1, a2)
+#       define INTEGRAL_IO_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(integral_io, name, a1, a2, a3)
+#   endif
+#endif
+#if !defined(INTEGRAL_IO_PROBE1)
+#   define INTEGRAL_IO_PROBE1(name, a1) ((void)0)
+#   define INTEGRAL_IO_PROBE2(name, a1, a2) ((void)0)
+#   define INTEGRAL_IO_PROBE3(name, a1, a2, a3) ((void)0)
+#endif
+
+#if defined(min) || defined(max)
+#   error min() and max() macros must not be defined. For Windows, define NOMINMAX before including the Windows headers.
+#endif
+
+namespace integral_io
+{
+    // Generic trait which handles any signed or unsigned integer which is bigger than 1 byte.
+    template <typename Integer, typename = std::enable_if_t<std::is_integral_v<Integer>, Integer>, std::size_t = sizeof(Integer), bool = std::is_signed<Integer>::value>
+    struct integral_io_trait
+    {
+        using type = Integer;
+    };
+
+    // Trait specialised for signed integers which are exactly 1 byte.
+    template <typename Integer>
+    struct integral_io_trait<Integer, Integer, 1, true>
+    {
+        using type = std::int16_t;
+    };
+
+    // Trait specialised for unsigned integers which are exactly 1 byte.
+    template <typename Integer>
+    struct integral_io_trait<Integer, Integer, 1, false>
+    {
+        using type = std::uint16_t;
+    };
+
+    // Helper template alias.
+    template <typename Integer>
+    using integral_io_t = typename integral_io_trait<Integer>::type;
+
+
+    // Latency instrumentation:
+
+    // The kinds of call which can be timed by the latency instrumentation.
+    enum class operation : std::size_t
+    {
+        format,
+        parse,
+        bulk_format,
+        bulk_parse,
+    };
+
+    constexpr std::size_t operation_count = 4;
+
+    inline const char* operation_name(const operation op)
+    {
+        switch (op)
+        {
+        case operation::format: return "format";
+        case operation::parse: return "parse";
+        case operation::bulk_format: return "bulk_format";
+        case operation::bulk_parse: return "bulk_parse";
+        }
+        return "unknown";
+    }
+
+    namespace detail
+    {
+        // Returns the index of the most significant set bit. The value must not be zero.
+        inline unsigned most_significant_bit(const std::uint64_t value) noexcept
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#elif defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanReverse64(&index, value);
+            return static_cast<unsigned>(index);
+#else
+            unsigned index = 0;
+            for (std::uint64_t v = value; v >>= 1; ++index) {}
+            return index;
+#endif
+        }
+
+        // Returns the index of the least significant set bit. The value must not be zero.
+        inline unsigned least_significant_bit(const std::uint64_t value) noexcept
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<unsigned>(__builtin_ctzll(value));
+#elif defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return static_cast<unsigned>(index);
+#else
+            unsigned index = 0;
+            for (std::uint64_t v = value; (v & 1) == 0; v >>= 1, ++index) {}
+            return index;
+#endif
+        }
+
+        // Reverses the order of an integer's bytes.
+        template <typename Integer>
+        Integer byte_swap(const Integer value) noexcept
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+            const auto bits = static_cast<unsigned_type>(value);
+            if constexpr (sizeof(Integer) == 1)
+                return value;
+#if defined(__GNUC__) || defined(__clang__)
+            else if constexpr (sizeof(Integer) == 2)
+                return static_cast<Integer>(__builtin_bswap16(bits));
+            else if constexpr (sizeof(Integer) == 4)
+                return static_cast<Integer>(__builtin_bswap32(bits));
+            else
+                return static_cast<Integer>(__builtin_bswap64(bits));
+#elif defined(_MSC_VER)
+            else if constexpr (sizeof(Integer) == 2)
+                return static_cast<Integer>(_byteswap_ushort(bits));
+            else if constexpr (sizeof(Integer) == 4)
+                return static_cast<Integer>(_byteswap_ulong(bits));
+            else
+                return static_cast<Integer>(_byteswap_uint64(bits));
+#else
+            else
+            {
+                unsigned_type swapped = 0;
+                for (std::size_t i = 0; i < sizeof(Integer); ++i)
+                    swapped = static_cast<unsigned_type>(swapped << 8 | ((bits >> (8 * i)) & 0xFF));
+                return static_cast<Integer>(swapped);
+            }
+#endif
+        }
+
+        // Reads a cheap, monotonic tick counter. This is the timestamp counter on x86, and falls back
+        //  to the steady clock (in nanoseconds) elsewhere.
+        inline std::uint64_t read_timestamp() noexcept
+        {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+            return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+    }
+
+    // A log-linear histogram of latencies, measured in ticks of detail::read_timestamp().
+    // Small values are counted exactly. Larger values are grouped by power of two, and each power of
+    //  two is split into sub_bucket_count linear steps. This bounds the error of any reported value
+    //  to 1/sub_bucket_count of its magnitude while keeping the whole histogram under 8 KB.
+    class latency_histogram
+    {
+    public:
+        static constexpr unsigned sub_bucket_bits = 4;
+        static constexpr std::size_t sub_bucket_count = std::size_t{ 1 } << sub_bucket_bits;
+        static constexpr std::size_t bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+        static std::size_t bucket_index(const std::uint64_t ticks) noexcept
+        {
+            if (ticks < sub_bucket_count)
+                return static_cast<std::size_t>(ticks);
+
+            const unsigned shift = detail::most_significant_bit(ticks) - sub_bucket_bits;
+            return (shift + 1) * sub_bucket_count + static_cast<std::size_t>((ticks >> shift) - sub_bucket_count);
+        }
+
+        // The smallest value which is counted in the given bucket.
+        static std::uint64_t bucket_lowest(const std::size_t index) noexcept
+        {
+            if (index < sub_bucket_count)
+                return index;
+
+            const std::size_t shift = index / sub_bucket_count - 1;
+            return static_cast<std::uint64_t>(sub_bucket_count + index % sub_bucket_count) << shift;
+        }
+
+        // The largest value which is counted in the given bucket.
+        static std::uint64_t bucket_highest(const std::size_t index) noexcept
+        {
+            if (index < sub_bucket_count)
+                return index;
+
+            const std::size_t shift = index / sub_bucket_count - 1;
+            return bucket_lowest(index) + ((std::uint64_t{ 1 } << shift) - 1);
+        }
+
+        void record(const std::uint64_t ticks, const std::uint64_t count = 1) noexcept
+        {
+            m_counts[bucket_index(ticks)] += count;
+        }
+
+        void merge(const latency_histogram& other) noexcept
+        {
+            for (std::size_t i = 0; i < bucket_count; ++i)
+                m_counts[i] += other.m_counts[i];
+        }
+
+        void reset() noexcept
+        {
+            m_counts.fill(0);
+        }
+
+        std::uint64_t count(const std::size_t index) const noexcept
+        {
+            return m_counts[index];
+        }
+
+        std::uint64_t total_count() const noexcept
+        {
+            std::uint64_t total = 0;
+            for (const auto c : m_counts)
+                total += c;
+            return total;
+        }
+
+        // Returns the highest value equivalent to the given percentile (0 to 100), or 0 if the
+        //  histogram is empty.
+        std::uint64_t value_at_percentile(const double percentile) const noexcept
+        {
+            const std::uint64_t total = total_count();
+            if (total == 0)
+                return 0;
+
+            const double clamped = percentile < 0.0 ? 0.0 : (percentile > 100.0 ? 100.0 : percentile);
+            std::uint64_t target = static_cast<std::uint64_t>(clamped / 100.0 * static_cast<double>(total) + 0.5);
+            if (target == 0)
+                target = 1;
+
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < bucket_count; ++i)
+            {
+                seen += m_counts[i];
+                if (seen >= target)
+                    return bucket_highest(i);
+            }
+            return max_value();
+        }
+
+        std::uint64_t min_value() const noexcept
+        {
+            for (std::size_t i = 0; i < bucket_count; ++i)
+            {
+                if (m_counts[i] != 0)
+                    return bucket_lowest(i);
+            }
+            return 0;
+        }
+
+        std::uint64_t max_value() const noexcept
+        {
+            for (std::size_t i = bucket_count; i-- > 0;)
+            {
+                if (m_counts[i] != 0)
+                    return bucket_highest(i);
+            }
+            return 0;
+        }
+
+        // Writes a percentile summary followed by the non-empty buckets, one per line.
+        template <typename Elem, typename Traits>
+        void write_text(std::basic_ostream<Elem, Traits>& os) const
+        {
+            const std::uint64_t total = total_count();
+            os << "count " << total
+               << " min " << min_value()
+               << " p50 " << value_at_percentile(50.0)
+               << " p90 " << value_at_percentile(90.0)
+               << " p99 " << value_at_percentile(99.0)
+               << " p99.9 " << value_at_percentile(99.9)
+               << " p99.99 " << value_at_percentile(99.99)
+               << " max " << max_value() << '\n';
+
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < bucket_count; ++i)
+            {
+                if (m_counts[i] == 0)
+                    continue;
+
+                seen += m_counts[i];
+                os << std::setw(20) << bucket_highest(i)
+                   << std::setw(14) << m_counts[i]
+                   << std::setw(12) << std::fixed << std::setprecision(6)
+                   << (100.0 * static_cast<double>(seen) / static_cast<double>(total)) << '\n';
+            }
+        }
+
+    private:
+        std::array<std::uint64_t, bucket_count> m_counts{};
+    };
+
+    namespace detail
+    {
+        // Keeps track of a per-thread recorder object for every live thread, so that their contents
+        //  can be merged on demand. Recorders belonging to threads which have exited are folded into
+        //  a retained snapshot so that nothing is lost.
+        template <typename Recorder>
+        class thread_registry
+        {
+        public:
+            using snapshot_type = typename Recorder::snapshot_type;
+
+            static thread_registry& instance()
+            {
+                static thread_registry registry;
+                return registry;
+            }
+
+            void attach(const Recorder* recorder)
+            {
+                const std::lock_guard<std::mutex> lock{ m_mutex };
+                m_live.push_back(recorder);
+            }
+
+            void detach(const Recorder* recorder)
+            {
+                const std::lock_guard<std::mutex> lock{ m_mutex };
+                recorder->merge_into(m_retired);
+                for (auto it = m_live.begin(); it != m_live.end(); ++it)
+                {
+                    if (*it == recorder)
+                    {
+                        m_live.erase(it);
+                        break;
+                    }
+                }
+            }
+
+            snapshot_type collect()
+            {
+                const std::lock_guard<std::mutex> lock{ m_mutex };
+                snapshot_type snapshot = m_retired;
+                for (const Recorder* recorder : m_live)
+                    recorder->merge_into(snapshot);
+                return snapshot;
+            }
+
+            void reset()
+            {
+                const std::lock_guard<std::mutex> lock{ m_mutex };
+                m_retired = snapshot_type{};
+                for (const Recorder* recorder : m_live)
+                    recorder->reset();
+            }
+
+        private:
+            thread_registry() = default;
+
+            std::mutex m_mutex;
+            std::vector<const Recorder*> m_live;
+            snapshot_type m_retired{};
+        };
+
+        // Owns the calling thread's recorder and keeps it registered for the lifetime of the thread.
+        template <typename Recorder>
+        struct registered_recorder
+        {
+            registered_recorder() { thread_registry<Recorder>::instance().attach(&m_recorder); }
+            registered_recorder(const registered_recorder&) = delete;
+            registered_recorder& operator=(const registered_recorder&) = delete;
+            ~registered_recorder() { thread_registry<Recorder>::instance().detach(&m_recorder); }
+
+            Recorder m_recorder;
+        };
+
+        template <typename Recorder>
+        Recorder& this_thread_recorder()
+        {
+            thread_local registered_recorder<Recorder> registered;
+            return registered.m_recorder;
+        }
+
+        // Latency counters belonging to a single thread. Only the owning thread writes to them, but
+        //  other threads read them while merging, so relaxed atomics are used instead of plain counts.
+        class thread_latency_recorder
+        {
+        public:
+            using snapshot_type = std::array<latency_histogram, operation_count>;
+
+            thread_latency_recorder() noexcept
+            {
+                reset();
+            }
+
+            void record(const operation op, const std::uint64_t ticks) noexcept
+            {
+                auto& counter = m_counts[static_cast<std::size_t>(op)][latency_histogram::bucket_index(ticks)];
+                counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+
+            void merge_into(snapshot_type& snapshot) const noexcept
+            {
+                for (std::size_t op = 0; op < operation_count; ++op)
+                {
+                    for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i)
+                    {
+                        const std::uint64_t count = m_counts[op][i].load(std::memory_order_relaxed);
+                        if (count != 0)
+                            snapshot[op].record(latency_histogram::bucket_lowest(i), count);
+                    }
+                }
+            }
+
+            void reset() const noexcept
+            {
+                for (auto& histogram : m_counts)
+                {
+                    for (auto& counter : histogram)
+                        counter.store(0, std::memory_order_relaxed);
+                }
+            }
+
+        private:
+            mutable std::atomic<std::uint64_t> m_counts[operation_count][latency_histogram::bucket_count];
+        };
+
+        // Times the enclosing scope if the policy enables latency recording. Otherwise it is empty and
+        //  compiles to nothing.
+        template <typename Policy, bool = Policy::record_latency>
+        struct latency_scope
+        {
+            explicit latency_scope(operation) noexcept {}
+        };
+
+        template <typename Policy>
+        struct latency_scope<Policy, true>
+        {
+            explicit latency_scope(const operation op) noexcept : m_op{ op }, m_start{ read_timestamp() } {}
+            latency_scope(const latency_scope&) = delete;
+            latency_scope& operator=(const latency_scope&) = delete;
+            ~latency_scope()
+            {
+                this_thread_recorder<thread_latency_recorder>().record(m_op, read_timestamp() - m_start);
+            }
+
+            const operation m_op;
+            const std::uint64_t m_start;
+        };
+    }
+
+    // Merges the latency histograms of all threads (including threads which have exited) for the
+    //  given kind of operation.
+    inline latency_histogram latency_snapshot(const operation op)
+    {
+        return detail::thread_registry<detail::thread_latency_recorder>::instance().collect()[static_cast<std::size_t>(op)];
+    }
+
+    // Discards all latency samples recorded so far.
+    inline void reset_latency()
+    {
+        detail::thread_registry<detail::thread_latency_recorder>::instance().reset();
+    }
+
+    // Writes the merged latency histograms for every kind of operation.
+    template <typename Elem, typename Traits>
+    void write_latency_report(std::basic_ostream<Elem, Traits>& os)
+    {
+        const auto snapshot = detail::thread_registry<detail::thread_latency_recorder>::instance().collect();
+        for (std::size_t op = 0; op < operation_count; ++op)
+        {
+            os << "# " << operation_name(static_cast<operation>(op)) << " (ticks)\n";
+            snapshot[op].write_text(os);
+        }
+    }
+
+
+    // Input events:
+
+    // Things which can go wrong (or be silently corrected) while reading an integer.
+    enum class input_event : std::size_t
+    {
+        clamp,          // The value was out of range, and was clamped to the nearest limit.
+        wrap,           // The value was out of range, and was wrapped around to fit the type.
+        parse_failure,  // No integer could be parsed at all.
+        out_of_range,   // The value was out of range, and was rejected without changing the destination.
+        too_long,       // The token exceeded the policy's length limits, and was abandoned.
+    };
+
+    constexpr std::size_t input_event_count = 5;
+
+    // Details of a single input event, passed to a policy's on_event() callback.
+    struct event_info
+    {
+        input_event kind;
+
+        // The offending value as text, or an empty view if it is not known (e.g. a parse failure).
+        // The view is only valid for the duration of the callback.
+        std::string_view text;
+    };
+
+    // Number of input events of each kind.
+    struct event_counts
+    {
+        std::uint64_t clamp = 0;
+        std::uint64_t wrap = 0;
+        std::uint64_t parse_failure = 0;
+        std::uint64_t out_of_range = 0;
+        std::uint64_t too_long = 0;
+    };
+
+    // What went wrong (if anything) when parsing a single integer.
+    enum class parse_error
+    {
+        none,
+        invalid,            // No integer could be parsed at all.
+        overflow_clamped,   // The value was out of range, and was clamped to the nearest limit.
+        wrapped,            // The value was out of range, and was wrapped around to fit the type.
+        out_of_range,       // The value was out of range, and was rejected without changing the destination.
+        too_long,           // The token exceeded the policy's length limits, and was abandoned.
+    };
+
+    namespace detail
+    {
+        // Event counters belonging to a single thread. See thread_latency_recorder.
+        class thread_event_recorder
+        {
+        public:
+            using snapshot_type = event_counts;
+
+            thread_event_recorder() noexcept
+            {
+                reset();
+            }
+
+            void record(const input_event kind) noexcept
+            {
+                auto& counter = m_counts[static_cast<std::size_t>(kind)];
+                counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+
+            void merge_into(snapshot_type& snapshot) const noexcept
+            {
+                snapshot.clamp += m_counts[static_cast<std::size_t>(input_event::clamp)].load(std::memory_order_relaxed);
+                snapshot.wrap += m_counts[static_cast<std::size_t>(input_event::wrap)].load(std::memory_order_relaxed);
+                snapshot.parse_failure += m_counts[static_cast<std::size_t>(input_event::parse_failure)].load(std::memory_order_relaxed);
+                snapshot.out_of_range += m_counts[static_cast<std::size_t>(input_event::out_of_range)].load(std::memory_order_relaxed);
+                snapshot.too_long += m_counts[static_cast<std::size_t>(input_event::too_long)].load(std::memory_order_relaxed);
+            }
+
+            void reset() const noexcept
+            {
+                for (auto& counter : m_counts)
+                    counter.store(0, std::memory_order_relaxed);
+            }
+
+        private:
+            mutable std::atomic<std::uint64_t> m_counts[input_event_count];
+        };
+
+        // Fires the parse_error tracepoint, then counts and/or reports an input event depending on
+        //  the policy. When the policy does neither, only the tracepoint's nop remains.
+        template <typename Policy>
+        void raise_event(const input_event kind, const std::string_view text = {})
+        {
+            INTEGRAL_IO_PROBE1(parse_error, static_cast<int>(kind));
+            if constexpr (Policy::count_events)
+                this_thread_recorder<thread_event_recorder>().record(kind);
+            if constexpr (Policy::notify_events)
+                Policy::on_event(event_info{ kind, text });
+        }
+
+    }
+
+    // Returns the input event counts recorded by the calling thread.
+    inline event_counts this_thread_event_counts()
+    {
+        event_counts counts;
+        detail::this_thread_recorder<detail::thread_event_recorder>().merge_into(counts);
+        return counts;
+    }
+
+    // Returns the total input event counts of all threads (including threads which have exited).
+    inline event_counts event_counts_snapshot()
+    {
+        return detail::thread_registry<detail::thread_event_recorder>::instance().collect();
+    }
+
+    // Discards all input event counts recorded so far.
+    inline void reset_event_counts()
+    {
+        detail::thread_registry<detail::thread_event_recorder>::instance().reset();
+    }
+
+
+    // Kernels:
+
+    // The versions of the kernels which scan text, e.g. for the end of a run of digits. The best one
+    //  the CPU supports is chosen the first time one is needed. The environment variable
+    //  INTEGRAL_IO_KERNEL can name a kernel to use instead (or the best supported one below it), so
+    //  that tests can cover every version on one machine.
+    enum class kernel
+    {
+        scalar,     // 8 bytes at a time, in a 64-bit register.
+        sse42,      // 16 bytes at a time, with PCMPESTRI.
+        avx2,       // 32 bytes at a time.
+        avx512bw,   // 64 bytes at a time.
+        avx512ifma, // As avx512bw, and bulk output formats (and sizes) 8 integers at a time.
+    };
+
+    constexpr std::size_t kernel_count = 5;
+
+    inline const char* kernel_name(const kernel k)
+    {
+        switch (k)
+        {
+        case kernel::scalar: return "scalar";
+        case kernel::sse42: return "sse42";
+        case kernel::avx2: return "avx2";
+        case kernel::avx512bw: return "avx512bw";
+        case kernel::avx512ifma: return "avx512ifma";
+        }
+        return "unknown";
+    }
+
+    // The SIMD kernels are compiled with target attributes rather than compiler flags, so one binary
+    //  has all of them. GNU ifunc isn't used because it doesn't work for inline functions.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#   define INTEGRAL_IO_X86_KERNELS 1
+#endif
+
+    inline bool kernel_supported(const kernel k)
+    {
+        switch (k)
+        {
+        case kernel::scalar: return true;
+#if defined(INTEGRAL_IO_X86_KERNELS)
+        case kernel::sse42: return __builtin_cpu_supports("sse4.2");
+        case kernel::avx2: return __builtin_cpu_supports("avx2");
+        case kernel::avx512bw: return __builtin_cpu_supports("avx512bw");
+        case kernel::avx512ifma: return __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512cd") && __builtin_cpu_supports("avx512ifma");
+#else
+        default: return false;
+#endif
+        }
+        return false;
+    }
+
+    namespace detail
+    {
+        // Returns a pointer to the first character in [first, last) which is not a decimal digit, or
+        //  last if there isn't one. This checks 8 characters at a time.
+        inline const char* find_non_digit_scalar(const char* first, const char* const last) noexcept
+        {
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+            while (last - first >= 8)
+            {
+                std::uint64_t chunk;
+                std::memcpy(&chunk, first, sizeof(chunk));
+
+                // Digits become 0-9 in each byte. Anything else has its top bit set after adding 0x76
+                //  to the low 7 bits (which can't carry into the next byte), or already had it set.
+                const std::uint64_t x = chunk ^ 0x3030303030303030u;
+                const std::uint64_t non_digits = (((x & 0x7F7F7F7F7F7F7F7Fu) + 0x7676767676767676u) | x) & 0x8080808080808080u;
+                if (non_digits != 0)
+                    return first + (least_significant_bit(non_digits) >> 3);
+                first += 8;
+            }
+#endif
+            while (first != last && static_cast<unsigned>(*first - '0') <= 9)
+                ++first;
+            return first;
+        }
+
+        // Copies count integers of 2, 4 or 8 bytes, reversing the bytes of each. Neither side needs to
+        //  be aligned, and the input and output may be the same.
+        inline void byte_swap_scalar(const void* const input, void* const output, const std::size_t count, const std::size_t size) noexcept
+        {
+            const auto swap_all = [input, output, count](auto zero)
+            {
+                using unsigned_type = decltype(zero);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    unsigned_type value;
+                    std::memcpy(&value, static_cast<const char*>(input) + i * sizeof(value), sizeof(value));
+                    value = byte_swap(value);
+                    std::memcpy(static_cast<char*>(output) + i * sizeof(value), &value, sizeof(value));
+                }
+            };
+            if (size == 2)
+                swap_all(std::uint16_t{ 0 });
+            else if (size == 4)
+                swap_all(std::uint32_t{ 0 });
+            else
+                swap_all(std::uint64_t{ 0 });
+        }
+
+        // The PSHUFB control which reverses each integer of 2, 4 or 8 bytes, indexed by log2(size) - 1.
+        //  It's the same for each 16-byte lane, and long enough for a 64-byte vector.
+        struct byte_swap_shuffles
+        {
+            std::uint8_t control[3][64] = {};
+
+            constexpr byte_swap_shuffles()
+            {
+                for (unsigned log = 1; log <= 3; ++log)
+                {
+                    const unsigned size = 1u << log;
+                    for (unsigned i = 0; i < 64; ++i)
+                        control[log - 1][i] = static_cast<std::uint8_t>(i % 16 / size * size + size - 1 - i % size);
+                }
+            }
+        };
+
+        inline constexpr byte_swap_shuffles byte_swap_control{};
+
+        inline const std::uint8_t* byte_swap_shuffle(const std::size_t size) noexcept
+        {
+            return byte_swap_control.control[size == 2 ? 0 : size == 4 ? 1 : 2];
+        }
+
+        // Each number of digits' smallest value, except that 0 has 1 digit.
+        inline constexpr std::uint64_t decimal_thresholds[20] = { 0, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+            10000000000, 100000000000, 1000000000000, 10000000000000, 100000000000000, 1000000000000000,
+            10000000000000000, 100000000000000000, 1000000000000000000, 10000000000000000000u };
+
+        // The number of decimal digits in a value. The bit length gives a guess which is at most one
+        //  too small (log10(2) is about 1233 / 4096).
+        inline unsigned decimal_digits(const std::uint64_t value) noexcept
+        {
+            const unsigned guess = ((most_significant_bit(value | 1) + 1) * 1233) >> 12;
+            return guess + (value >= decimal_thresholds[guess] ? 1 : 0);
+        }
+
+#if defined(INTEGRAL_IO_X86_KERNELS)
+        __attribute__((target("sse4.2")))
+        inline const char* find_non_digit_sse42(const char* first, const char* const last) noexcept
+        {
+            const __m128i digits = _mm_setr_epi8('0', '9', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+            while (last - first >= 16)
+            {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+                const int index = _mm_cmpestri(digits, 2, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY);
+                if (index != 16)
+                    return first + index;
+                first += 16;
+            }
+            return find_non_digit_scalar(first, last);
+        }
+
+        __attribute__((target("avx2")))
+        inline const char* find_non_digit_avx2(const char* first, const char* const last) noexcept
+        {
+            const __m256i zero = _mm256_set1_epi8('0');
+            const __m256i nine = _mm256_set1_epi8(9);
+            while (last - first >= 32)
+            {
+                const __m256i x = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), zero);
+                const auto non_digits = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(x, nine), x)));
+                if (non_digits != 0)
+                    return first + least_significant_bit(non_digits);
+                first += 32;
+            }
+            return find_non_digit_scalar(first, last);
+        }
+
+        __attribute__((target("avx512bw")))
+        inline const char* find_non_digit_avx512bw(const char* first, const char* const last) noexcept
+        {
+            const __m512i zero = _mm512_set1_epi8('0');
+            const __m512i nine = _mm512_set1_epi8(9);
+            while (last - first >= 64)
+            {
+                const __m512i x = _mm512_sub_epi8(_mm512_loadu_si512(first), zero);
+                const std::uint64_t non_digits = ~static_cast<std::uint64_t>(_mm512_cmple_epu8_mask(x, nine));
+                if (non_digits != 0)
+                    return first + least_significant_bit(non_digits);
+                first += 64;
+            }
+            return find_non_digit_scalar(first, last);
+        }
+
+        // Byte swapping, with PSHUFB reversing every integer in a vector at once.
+        __attribute__((target("sse4.2")))
+        inline void byte_swap_sse42(const void* const input, void* const output, const std::size_t count, const std::size_t size) noexcept
+        {
+            const __m128i control = _mm_loadu_si128(reinterpret_cast<const __m128i*>(byte_swap_shuffle(size)));
+            const std::size_t bytes = count * size;
+            std::size_t i = 0;
+            for (; bytes - i >= 16; i += 16)
+            {
+                const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const char*>(input) + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(static_cast<char*>(output) + i), _mm_shuffle_epi8(x, control));
+            }
+            byte_swap_scalar(static_cast<const char*>(input) + i, static_cast<char*>(output) + i, (bytes - i) / size, size);
+        }
+
+        __attribute__((target("avx2")))
+        inline void byte_swap_avx2(const void* const input, void* const output, const std::size_t count, const std::size_t size) noexcept
+        {
+            const __m256i control = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(byte_swap_shuffle(size)));
+            const std::size_t bytes = count * size;
+            std::size_t i = 0;
+            for (; bytes - i >= 32; i += 32)
+            {
+                const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const char*>(input) + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(static_cast<char*>(output) + i), _mm256_shuffle_epi8(x, control));
+            }
+            byte_swap_sse42(static_cast<const char*>(input) + i, static_cast<char*>(output) + i, (bytes - i) / size, size);
+        }
+
+        __attribute__((target("avx512bw")))
+        inline void byte_swap_avx512bw(const void* const input, void* const output, const std::size_t count, const std::size_t size) noexcept
+        {
+            const __m512i control = _mm512_loadu_si512(byte_swap_shuffle(size));
+            const std::size_t bytes = count * size;
+            std::size_t i = 0;
+            for (; bytes - i >= 64; i += 64)
+            {
+                const __m512i x = _mm512_loadu_si512(static_cast<const char*>(input) + i);
+                _mm512_storeu_si512(static_cast<char*>(output) + i, _mm512_shuffle_epi8(x, control));
+            }
+            byte_swap_avx2(static_cast<const char*>(input) + i, static_cast<char*>(output) + i, (bytes - i) / size, size);
+        }
+
+        // The interleaving of three vectors of 8 lanes each into 8 consecutive triples, done with one
+        //  two-source permute and one masked permute per output vector.
+        struct triple_interleave
+        {
+            std::uint64_t pair_index[3][8] = {};
+            std::uint64_t third_index[3][8] = {};
+            std::uint8_t third_mask[3] = {};
+
+            constexpr triple_interleave()
+            {
+                for (unsigned lane = 0; lane < 24; ++lane)
+                {
+                    const unsigned vector = lane / 8, value = lane / 3, part = lane % 3;
+                    if (part == 2)
+                    {
+                        third_index[vector][lane % 8] = value;
+                        third_mask[vector] = static_cast<std::uint8_t>(third_mask[vector] | (1u << (lane % 8)));
+                    }
+                    else
+                    {
+                        pair_index[vector][lane % 8] = value + 8 * part;
+                    }
+                }
+            }
+        };
+
+        // Counts the characters needed for blocks of 8 signed or unsigned 8-byte integers, as
+        //  decimal_digits() does (plus a sign for negative values), 8 at a time. Like the zero-masked
+        //  shift in render_decimal_ifma(), the masked operations avoid spurious GCC 12 warnings.
+        __attribute__((target("avx512f,avx512cd")))
+        inline std::size_t count_characters_avx512(const void* const values, const std::size_t blocks, const bool is_signed) noexcept
+        {
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i one = _mm512_set1_epi64(1);
+            __m512i total = zero;
+            for (std::size_t block = 0; block < blocks; ++block)
+            {
+                __m512i v = _mm512_loadu_si512(static_cast<const char*>(values) + 64 * block);
+                if (is_signed)
+                {
+                    total = _mm512_mask_add_epi64(total, _mm512_cmplt_epi64_mask(v, zero), total, one);
+                    v = _mm512_maskz_abs_epi64(0xFF, v);
+                }
+                const __m512i bits = _mm512_sub_epi64(_mm512_set1_epi64(64), _mm512_lzcnt_epi64(_mm512_or_si512(v, one)));
+                const __m512i guess = _mm512_maskz_srli_epi64(0xFF, _mm512_mullo_epi32(bits, _mm512_set1_epi64(1233)), 12);
+                const __m512i threshold = _mm512_mask_i64gather_epi64(zero, 0xFF, guess, static_cast<const void*>(decimal_thresholds), 8);
+                total = _mm512_add_epi64(total, guess);
+                total = _mm512_mask_add_epi64(total, _mm512_cmpge_epu64_mask(v, threshold), total, one);
+            }
+            alignas(64) std::uint64_t lanes[8];
+            _mm512_store_si512(lanes, total);
+            std::size_t characters = 0;
+            for (const std::uint64_t lane : lanes)
+                characters += static_cast<std::size_t>(lane);
+            return characters;
+        }
+
+        // Writes 8 values as 24 decimal digits each (with leading zeros) to 192 consecutive bytes.
+        //  Each value is split into three parts below 10^8. The digit k places from the right of a part
+        //  x is then floor(10 * frac(x / 10^k)), which 52-bit multiplies by ceil(2^52 / 10^k) give
+        //  exactly, 8 values at a time. (The leftmost digit is floor(x / 10^7) instead, as the
+        //  fraction's rounding error is too large there.) All 10^8 parts have been checked.
+        __attribute__((target("avx512f,avx512ifma")))
+        inline void render_decimal_ifma(const std::uint64_t* const values, char* const digits) noexcept
+        {
+            alignas(64) std::uint64_t parts[3][8];
+            for (unsigned i = 0; i < 8; ++i)
+            {
+                const std::uint64_t upper = values[i] / 100000000;
+                parts[0][i] = upper / 100000000;
+                parts[1][i] = upper % 100000000;
+                parts[2][i] = values[i] % 100000000;
+            }
+
+            static constexpr std::uint64_t reciprocals[8] = { 0, 450359962737050, 45035996273705, 4503599627371, 450359962738, 45035996274, 4503599628, 450359963 };
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i ten = _mm512_set1_epi64(10);
+            __m512i packed[3];
+            for (unsigned p = 0; p < 3; ++p)
+            {
+                const __m512i x = _mm512_load_si512(parts[p]);
+                __m512i text = _mm512_madd52hi_epu64(zero, x, _mm512_set1_epi64(static_cast<long long>(reciprocals[7])));
+                for (unsigned k = 7; k >= 1; --k)
+                {
+                    const __m512i fraction = _mm512_madd52lo_epu64(zero, x, _mm512_set1_epi64(static_cast<long long>(reciprocals[k])));
+                    const __m512i digit = _mm512_madd52hi_epu64(zero, fraction, ten);
+                    // The zero-masked shift is the same as _mm512_slli_epi64, which GCC 12 warns about.
+                    text = _mm512_or_si512(text, _mm512_maskz_slli_epi64(0xFF, digit, 8 * (8 - k)));
+                }
+                packed[p] = _mm512_or_si512(text, _mm512_set1_epi8('0'));
+            }
+
+            static constexpr triple_interleave interleave{};
+            for (unsigned v = 0; v < 3; ++v)
+            {
+                const __m512i pairs = _mm512_permutex2var_epi64(packed[0], _mm512_loadu_si512(interleave.pair_index[v]), packed[1]);
+                const __m512i triples = _mm512_mask_permutexvar_epi64(pairs, interleave.third_mask[v], _mm512_loadu_si512(interleave.third_index[v]), packed[2]);
+                _mm512_storeu_si512(digits + 64 * v, triples);
+            }
+        }
+#endif
+
+        using render_decimal_function = void (*)(const std::uint64_t*, char*) noexcept;
+        using count_characters_function = std::size_t (*)(const void*, std::size_t, bool) noexcept;
+
+        using find_non_digit_function = const char* (*)(const char*, const char*) noexcept;
+        using byte_swap_function = void (*)(const void*, void*, std::size_t, std::size_t) noexcept;
+
+        inline find_non_digit_function find_non_digit_version(const kernel k)
+        {
+            switch (k)
+            {
+#if defined(INTEGRAL_IO_X86_KERNELS)
+            case kernel::sse42: return &find_non_digit_sse42;
+            case kernel::avx2: return &find_non_digit_avx2;
+            case kernel::avx512bw: return &find_non_digit_avx512bw;
+            case kernel::avx512ifma: return &find_non_digit_avx512bw;
+#endif
+            default: return &find_non_digit_scalar;
+            }
+        }
+
+        inline byte_swap_function byte_swap_version(const kernel k)
+        {
+            switch (k)
+            {
+#if defined(INTEGRAL_IO_X86_KERNELS)
+            case kernel::sse42: return &byte_swap_sse42;
+            case kernel::avx2: return &byte_swap_avx2;
+            case kernel::avx512bw: return &byte_swap_avx512bw;
+            case kernel::avx512ifma: return &byte_swap_avx512bw;
+#endif
+            default: return &byte_swap_scalar;
+            }
+        }
+
+        // The vectorised character count for a kernel, or nullptr if it has none.
+        inline count_characters_function count_characters_version(const kernel k)
+        {
+#if defined(INTEGRAL_IO_X86_KERNELS)
+            if (k == kernel::avx512ifma)
+                return &count_characters_avx512;
+#endif
+            static_cast<void>(k);
+            return nullptr;
+        }
+
+        // The batch formatter for a kernel, or nullptr if it has none.
+        inline render_decimal_function render_decimal_version(const kernel k)
+        {
+#if defined(INTEGRAL_IO_X86_KERNELS)
+            if (k == kernel::avx512ifma)
+                return &render_decimal_ifma;
+#endif
+            static_cast<void>(k);
+            return nullptr;
+        }
+
+        // Returns the best supported kernel which is no better than the one given.
+        inline kernel best_supported_kernel(kernel limit)
+        {
+            while (limit != kernel::scalar && !kernel_supported(limit))
+                limit = static_cast<kernel>(static_cast<int>(limit) - 1);
+            return limit;
+        }
+
+        inline kernel select_kernel()
+        {
+            kernel limit = kernel::avx512ifma;
+            if (const char* const forced = std::getenv("INTEGRAL_IO_KERNEL"))
+            {
+                for (std::size_t k = 0; k < kernel_count; ++k)
+                {
+                    if (std::strcmp(forced, kernel_name(static_cast<kernel>(k))) == 0)
+                        limit = static_cast<kernel>(k);
+                }
+            }
+            return best_supported_kernel(limit);
+        }
+
+        const char* resolve_find_non_digit(const char* first, const char* last) noexcept;
+
+        // The kernel pointers start out pointing at a resolver, which chooses the kernel on first use.
+        //  They are constant-initialised, so they work from static initialisers too.
+        inline std::atomic<find_non_digit_function> find_non_digit_kernel{ &resolve_find_non_digit };
+        inline std::atomic<render_decimal_function> render_decimal_kernel{ nullptr };
+        inline std::atomic<count_characters_function> count_characters_kernel{ nullptr };
+        inline std::atomic<byte_swap_function> byte_swap_kernel{ &byte_swap_scalar };
+        inline std::atomic<kernel> installed_kernel{ kernel::scalar };
+
+        inline void install_kernel(const kernel k)
+        {
+            installed_kernel.store(k, std::memory_order_relaxed);
+            find_non_digit_kernel.store(find_non_digit_version(k), std::memory_order_relaxed);
+            render_decimal_kernel.store(render_decimal_version(k), std::memory_order_relaxed);
+            count_characters_kernel.store(count_characters_version(k), std::memory_order_relaxed);
+            byte_swap_kernel.store(byte_swap_version(k), std::memory_order_relaxed);
+        }
+
+        inline void initialise_kernels()
+        {
+            static const bool initialised = (install_kernel(select_kernel()), true);
+            static_cast<void>(initialised);
+        }
+
+        inline const char* resolve_find_non_digit(const char* const first, const char* const last) noexcept
+        {
+            initialise_kernels();
+            return find_non_digit_kernel.load(std::memory_order_relaxed)(first, last);
+        }
+    }
+
+    // The kernel in use.
+    inline kernel active_kernel()
+    {
+        detail::initialise_kernels();
+        return detail::installed_kernel.load(std::memory_order_relaxed);
+    }
+
+    // Switches to the given kernel, or the best supported one below it. Returns the one now in use.
+    inline kernel use_kernel(const kernel requested)
+    {
+        detail::initialise_kernels();
+        const kernel k = detail::best_supported_kernel(requested);
+        detail::install_kernel(k);
+        return k;
+    }
+
+
+    // Threads:
+    namespace detail
+    {
+        // Splits [0, count) into contiguous blocks of at least min_block items, one per thread, and
+        //  calls work(begin, end) for each block. The first block runs on the calling thread. A thread
+        //  count of 0 means one per hardware thread. If any block throws, the first exception is
+        //  rethrown once every block has finished.
+        template <typename Work>
+        void parallel_blocks(const std::size_t count, std::size_t threads, const std::size_t min_block, const Work& work)
+        {
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            const std::size_t blocks = std::max<std::size_t>(1, std::min(threads, count / std::max<std::size_t>(min_block, 1)));
+            if (blocks == 1)
+            {
+                if (count != 0)
+                {
+                    INTEGRAL_IO_PROBE2(chunk_dispatch, std::size_t{ 0 }, count);
+                    work(std::size_t{ 0 }, count);
+                }
+                return;
+            }
+
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            const auto run = [&](const std::size_t block)
+            {
+                try
+                {
+                    const std::size_t begin = count / blocks * block + std::min(block, count % blocks);
+                    const std::size_t end = count / blocks * (block + 1) + std::min(block + 1, count % blocks);
+                    INTEGRAL_IO_PROBE2(chunk_dispatch, begin, end);
+                    work(begin, end);
+                }
+                catch (...)
+                {
+                    const std::lock_guard<std::mutex> lock{ error_mutex };
+                    if (!error)
+                        error = std::current_exception();
+                }
+            };
+
+            std::vector<std::thread> workers;
+            workers.reserve(blocks - 1);
+            try
+            {
+                for (std::size_t block = 1; block < blocks; ++block)
+                    workers.emplace_back(run, block);
+            }
+            catch (...)
+            {
+                // Couldn't start a thread, so do the remaining blocks here.
+                for (std::size_t block = workers.size() + 1; block < blocks; ++block)
+                    run(block);
+            }
+            run(0);
+            for (auto& worker : workers)
+                worker.join();
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        // How a batch of text was split by parallel_text_blocks(): the text before end went into
+        //  blocks, and the rest belongs to the next batch. No blocks means there was nowhere to split.
+        struct text_blocks
+        {
+            std::size_t end = 0;
+            std::size_t blocks = 0;
+        };
+
+        // Parses a batch of text (typically a few MB per thread) in parallel. Unless it's the last
+        //  batch, the text is trimmed back to just after its last boundary character (e.g.
+        //  whitespace), leaving a value which may carry on into the next batch for that one. The rest
+        //  is split at boundaries into up to one block per thread, each of at least about 64 KB, and
+        //  work(block, text) is called for each block on its own thread. Blocks are numbered in
+        //  order, so the caller can join their results in order once this returns. A thread count of
+        //  0 means one per hardware thread.
+        template <typename IsBoundary, typename Work>
+        text_blocks parallel_text_blocks(const std::string_view text, const bool last_batch, std::size_t threads, const IsBoundary& is_boundary, const Work& work)
+        {
+            text_blocks split;
+            split.end = text.size();
+            if (!last_batch)
+            {
+                while (split.end != 0 && !is_boundary(text[split.end - 1]))
+                    --split.end;
+                if (split.end == 0)
+                    return split;
+            }
+
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            split.blocks = std::max<std::size_t>(1, std::min(threads, split.end >> 16));
+            std::vector<std::string_view> bounds(split.blocks);
+            std::size_t start = 0;
+            for (std::size_t block = 0; block < split.blocks; ++block)
+            {
+                std::size_t stop = block + 1 == split.blocks ? split.end : std::max(start, split.end / split.blocks * (block + 1));
+                while (stop != split.end && !is_boundary(text[stop]))
+                    ++stop;
+                bounds[block] = text.substr(start, stop - start);
+                start = stop;
+            }
+
+            parallel_blocks(split.blocks, split.blocks, 1, [&](const std::size_t first_block, const std::size_t last_block)
+            {
+                for (std::size_t block = first_block; block < last_block; ++block)
+                    work(block, bounds[block]);
+            });
+            return split;
+        }
+    }
+
+    // Policies:
+
+    // Used for limits which don't apply.
+    constexpr std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+
+    // Which integers are written by copying from a table of pre-rendered strings, built at compile
+    //  time (or, for the 2-byte tables, on first use). The 1-byte tables take about 1 KB each, and
+    //  the 2-byte tables about 450 KB each.
+    enum class output_table
+    {
+        none,
+        bytes,              // 1-byte integers.
+        bytes_and_shorts,   // 1-byte and 2-byte integers.
+    };
+
+    // How integers are written in decimal. The suffixed notations use the largest suffix which
+    //  divides the value exactly (e.g. 4096 is 4Ki, 3000000 is 3M, and 1500 is 1500), so the text
+    //  reads back exactly with the human input grammar.
+    enum class output_notation
+    {
+        plain,
+        si,     // k, M, G, T, P or E for powers of 1000.
+        iec,    // Ki, Mi, Gi, Ti, Pi or Ei for powers of 1024.
+    };
+
+    // The syntax accepted for input tokens.
+    enum class input_grammar
+    {
+        stream,     // Whatever the stream accepts: leading whitespace, an optional + or - sign, etc.
+        strict,     // An optional minus sign and decimal digits, followed by the delimiter, a newline, or
+                    //  the end of the input. Nothing else (not even whitespace) is skipped.
+        human,      // As the stream grammar, but digits may be grouped with ' or _ (e.g. 1'000'000 or
+                    //  1_000_000), and may be followed by an SI or IEC suffix: k (or K), M, G, T, P or E
+                    //  for powers of 1000, or Ki, Mi, Gi, Ti, Pi or Ei for powers of 1024.
+    };
+
+    // What to do when an input value does not fit in the destination type.
+    enum class overflow_mode
+    {
+        stream,     // Behave like the stream does for wider types: signed values are clamped to the
+                    //  nearest limit and fail; negative values wrap round to fit unsigned types if
+                    //  their magnitude is in range, and are otherwise clamped to the maximum and fail.
+        saturate,   // Clamp to the nearest limit and fail.
+        fail_only,  // Fail without changing the destination.
+        wrap,       // Wrap round (modulo 2^bits) without failing.
+        unchecked,  // Don't check the range at all. Only use this for trusted inputs.
+    };
+
+    // How fixed-point input with more fraction digits than the scale is brought to the scale.
+    enum class rounding
+    {
+        half_even,      // To the nearest value, and ties to the even one (as IEEE arithmetic does).
+        half_away,      // To the nearest value, and ties away from zero.
+        toward_zero,    // Drop the extra digits.
+        exact,          // Fail unless the extra digits are all zeros.
+    };
+
+    // Compile-time options which control how a wrapper behaves. Custom policies should derive from
+    //  this and hide whichever members they want to change.
+    struct default_policy
+    {
+        // Record the latency of every call in the calling thread's latency histograms.
+        static constexpr bool record_latency = false;
+
+        // What to do when an input value is out of range.
+        static constexpr overflow_mode overflow = overflow_mode::stream;
+
+        // How as_fixed() rounds input which has more fraction digits than its scale.
+        static constexpr rounding fixed_rounding = rounding::half_even;
+
+        // The maximum number of characters in an input token (sign, leading zeros and digits). A
+        //  longer token fails as soon as the limit is reached, and nothing after it is consumed.
+        static constexpr std::size_t max_token_length = unlimited;
+
+        // The maximum number of leading zeros in an input token. A token of just "0" has none.
+        static constexpr std::size_t max_leading_zeros = unlimited;
+
+        // The syntax accepted for input tokens.
+        static constexpr input_grammar grammar = input_grammar::stream;
+
+        // The character written between values in bulk output, and expected after each value in
+        //  strict input.
+        static constexpr char delimiter = ' ';
+
+        // Output of small integers to char streams with default formatting can skip the stream's
+        //  num_put, and copy a pre-rendered string straight into the stream buffer instead.
+        static constexpr output_table table = output_table::none;
+
+        // Whether output has SI or IEC suffixes, e.g. 4k or 4Ki. This applies to single values and
+        //  bulk output in base 10 (other bases are left to the stream), but not to tables.
+        static constexpr output_notation notation = output_notation::plain;
+
+        // The base for input and output, from 2 to 62. Any base other than 10 overrides the stream's
+        //  basefield. Bases up to 36 use the digits 0-9 then a-z (and read A-Z too), and bigger bases
+        //  use 0-9, A-Z, then a-z, so that IDs of the same width sort in the same order as their
+        //  values. Output is zero-padded to at least radix_width digits (after any sign).
+        static constexpr unsigned radix = 10;
+        static constexpr std::size_t radix_width = 0;
+
+        // How containers and aggregates are written by as_integer(). Maps are written as e.g.
+        //  {1: 2, 3: 4}, other ranges as [1, 2], pairs and tuples as (1, 2), and empty optionals as none.
+        static constexpr std::string_view sequence_open = "[";
+        static constexpr std::string_view sequence_close = "]";
+        static constexpr std::string_view map_open = "{";
+        static constexpr std::string_view map_close = "}";
+        static constexpr std::string_view tuple_open = "(";
+        static constexpr std::string_view tuple_close = ")";
+        static constexpr std::string_view element_separator = ", ";
+        static constexpr std::string_view key_separator = ": ";
+        static constexpr std::string_view empty_optional = "none";
+
+        // How tables are written by as_table(): each column is right-aligned to its widest value,
+        //  padded with the fill character, and separated from the next by the column separator.
+        static constexpr char fill = ' ';
+        static constexpr std::string_view column_separator = " ";
+
+        // When bulk parsing with an error map, the value stored in place of each value which failed.
+        //  It is given the value as a failed stream read would have stored it.
+        template <typename Integer>
+        static constexpr Integer failed_value(const Integer parsed) { return parsed; }
+
+        // Count clamp, wrap and parse-failure events in the calling thread's event counters.
+        static constexpr bool count_events = false;
+
+        // Pass every clamp, wrap and parse-failure event to on_event().
+        static constexpr bool notify_events = false;
+
+        static void on_event(const event_info&) {}
+    };
+
+    // Policy which records per-call latency. See latency_snapshot() and write_latency_report().
+    struct latency_policy : default_policy
+    {
+        static constexpr bool record_latency = true;
+    };
+
+    // Policies which select an overflow mode, e.g. as_integer<saturate>(value).
+    struct saturate : default_policy
+    {
+        static constexpr overflow_mode overflow = overflow_mode::saturate;
+    };
+
+    struct fail_only : default_policy
+    {
+        static constexpr overflow_mode overflow = overflow_mode::fail_only;
+    };
+
+    struct wrap : default_policy
+    {
+        static constexpr overflow_mode overflow = overflow_mode::wrap;
+    };
+
+    struct unchecked : default_policy
+    {
+        static constexpr overflow_mode overflow = overflow_mode::unchecked;
+    };
+
+    // Policy which bounds the time spent on any one input token, for untrusted input. The limit is
+    //  enough for any 64-bit value with a sign and some zero padding.
+    struct bounded : default_policy
+    {
+        static constexpr std::size_t max_token_length = 48;
+    };
+
+    // Policy which accepts only the strict grammar, for trusted machine-generated input. Derive from
+    //  this to change the delimiter.
+    struct strict : default_policy
+    {
+        static constexpr input_grammar grammar = input_grammar::strict;
+    };
+
+    // Policy which writes 1-byte and 2-byte integers from pre-rendered tables.
+    struct table_policy : default_policy
+    {
+        static constexpr output_table table = output_table::bytes_and_shorts;
+    };
+
+    // Policies which read human-friendly sizes (see input_grammar::human), and write them back with
+    //  SI or IEC suffixes, e.g. as_integer<iec_suffixes>(bytes).
+    struct si_suffixes : default_policy
+    {
+        static constexpr input_grammar grammar = input_grammar::human;
+        static constexpr output_notation notation = output_notation::si;
+    };
+
+    struct iec_suffixes : default_policy
+    {
+        static constexpr input_grammar grammar = input_grammar::human;
+        static constexpr output_notation notation = output_notation::iec;
+    };
+
+    // Policy which reads and writes in another base, e.g. as_integer<radix_policy<62, 11>>(id) for
+    //  base-62 IDs which are always 11 digits long.
+    template <unsigned Radix, std::size_t Width = 0>
+    struct radix_policy : default_policy
+    {
+        static_assert(Radix >= 2 && Radix <= 62, "the radix must be from 2 to 62");
+        static constexpr unsigned radix = Radix;
+        static constexpr std::size_t radix_width = Width;
+    };
+
+    // Policy which counts input events. See this_thread_event_counts() and event_counts_snapshot().
+    struct counting_policy : default_policy
+    {
+        static constexpr bool count_events = true;
+    };
+
+    namespace detail
+    {
+        // An integer token read from the input, before it has been fitted to the destination type.
+        // The magnitude has the same width as the destination, so nothing goes through a wider type.
+        template <typename Unsigned>
+        struct parsed_token
+        {
+            Unsigned magnitude = 0; // Modulo 2^bits if the token was too big.
+            bool negative = false;
+            bool too_big = false;   // The magnitude does not fit in Unsigned.
+            bool too_long = false;  // The token exceeded the policy's length limits, so was abandoned.
+            bool valid = false;     // False if no integer could be parsed at all.
+        };
+
+        // The digits of each radix. Bases up to 36 are read in either case.
+        template <unsigned Base>
+        constexpr std::string_view radix_alphabet = Base <= 36
+            ? "0123456789abcdefghijklmnopqrstuvwxyz"
+            : "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+        // The value of each character as a digit in the base, or 0xFF if it isn't one.
+        template <unsigned Base>
+        constexpr std::array<std::uint8_t, 256> radix_values = []
+        {
+            std::array<std::uint8_t, 256> values{};
+            for (auto& value : values)
+                value = 0xFF;
+            for (unsigned digit = 0; digit < Base; ++digit)
+            {
+                const char c = radix_alphabet<Base>[digit];
+                values[static_cast<unsigned char>(c)] = static_cast<std::uint8_t>(digit);
+                if (Base <= 36 && c >= 'a')
+                    values[static_cast<unsigned char>(c - 'a' + 'A')] = static_cast<std::uint8_t>(digit);
+            }
+            return values;
+        }();
+
+        constexpr bool is_power_of_two(const unsigned value)
+        {
+            return (value & (value - 1)) == 0;
+        }
+
+        constexpr unsigned log2_of(const unsigned value)
+        {
+            unsigned shift = 0;
+            while ((1u << shift) < value)
+                ++shift;
+            return shift;
+        }
+
+        // The number of digits in the base which always fit in Unsigned, i.e. the largest k with
+        //  Base^k <= max.
+        template <unsigned Base, typename Unsigned>
+        constexpr unsigned radix_safe_digits = []
+        {
+            constexpr Unsigned max = static_cast<Unsigned>(~Unsigned{ 0 });
+            unsigned digits = 0;
+            for (Unsigned power = 1; power <= max / Base; power = static_cast<Unsigned>(power * Base))
+                ++digits;
+            return digits;
+        }();
+
+        // The largest power of the base which fits in Unsigned, for splitting a value into chunks of
+        //  radix_safe_digits digits.
+        template <unsigned Base, typename Unsigned>
+        constexpr Unsigned radix_chunk = []
+        {
+            Unsigned power = 1;
+            for (unsigned i = 0; i < radix_safe_digits<Base, Unsigned>; ++i)
+                power = static_cast<Unsigned>(power * Base);
+            return power;
+        }();
+
+        // Returns a pointer to the first character in [first, last) which is not a decimal digit, or
+        //  last if there isn't one, using the best available kernel. Short runs aren't worth a call
+        //  through the kernel pointer.
+        inline const char* find_non_digit(const char* const first, const char* const last) noexcept
+        {
+            if (last - first < 16)
+                return find_non_digit_scalar(first, last);
+            return find_non_digit_kernel.load(std::memory_order_relaxed)(first, last);
+        }
+
+        // Exposes a stream buffer's get area. Naming a protected member through a derived class gives
+        //  a pointer-to-member of the base class, which can be used on any stream buffer.
+        template <typename Elem, typename Traits>
+        struct get_area_access : std::basic_streambuf<Elem, Traits>
+        {
+            using streambuf_type = std::basic_streambuf<Elem, Traits>;
+
+            static Elem* current(streambuf_type* buffer)
+            {
+                return (buffer->*&get_area_access::gptr)();
+            }
+
+            static Elem* end(streambuf_type* buffer)
+            {
+                return (buffer->*&get_area_access::egptr)();
+            }
+
+            static void advance(streambuf_type* buffer, const int count)
+            {
+                (buffer->*&get_area_access::gbump)(count);
+            }
+        };
+
+        // Reads characters directly from a stream buffer. This bypasses num_get, so it must only be
+        //  used where num_get would see plain decimal digits (i.e. the classic locale in base 10).
+        template <typename Elem, typename Traits>
+        class streambuf_cursor
+        {
+        public:
+            explicit streambuf_cursor(std::basic_streambuf<Elem, Traits>* buffer) : m_buffer{ buffer }, m_current{ buffer->sgetc() } {}
+
+            bool at_end() const
+            {
+                return Traits::eq_int_type(m_current, Traits::eof());
+            }
+
+            // The value of the current character if it's a decimal digit, or something above 9 if not.
+            unsigned digit() const
+            {
+                return at_end() ? 10u : static_cast<unsigned>(Traits::to_char_type(m_current) - Elem('0'));
+            }
+
+            bool is(const char c) const
+            {
+                return !at_end() && Traits::eq(Traits::to_char_type(m_current), Elem(c));
+            }
+
+            // The current character, or '\0' at the end or if it isn't ASCII.
+            char character() const
+            {
+                if (at_end())
+                    return '\0';
+                const Elem e = Traits::to_char_type(m_current);
+                if constexpr (std::is_same<Elem, char>::value)
+                    return e;
+                else
+                    return static_cast<unsigned long long>(e) < 128 ? static_cast<char>(e) : '\0';
+            }
+
+            void next()
+            {
+                m_current = m_buffer->snextc();
+            }
+
+            // Skips up to limit digits, and returns how many were skipped. Narrow streams are scanned in
+            //  place in the buffer.
+            std::size_t skip_digits(const std::size_t limit)
+            {
+                std::size_t skipped = 0;
+                if constexpr (std::is_same<Elem, char>::value)
+                {
+                    using access = get_area_access<Elem, Traits>;
+                    while (skipped < limit && digit() <= 9)
+                    {
+                        // The current character is a digit, so it must be in the get area.
+                        const char* first = access::current(m_buffer);
+                        const auto available = static_cast<std::size_t>(access::end(m_buffer) - first);
+                        const std::size_t count = std::min({ available, limit - skipped, std::size_t{ INT_MAX } });
+                        const char* stop = find_non_digit(first, first + count);
+
+                        access::advance(m_buffer, static_cast<int>(stop - first));
+                        skipped += static_cast<std::size_t>(stop - first);
+                        m_current = m_buffer->sgetc();
+                        if (stop != first + count)
+                            break;
+                    }
+                }
+                else
+                {
+                    for (; skipped < limit && digit() <= 9; ++skipped)
+                        next();
+                }
+                return skipped;
+            }
+
+        private:
+            std::basic_streambuf<Elem, Traits>* m_buffer;
+            typename Traits::int_type m_current;
+        };
+
+        // Reads characters from memory.
+        class pointer_cursor
+        {
+        public:
+            pointer_cursor(const char* first, const char* last) : m_position{ first }, m_end{ last } {}
+
+            bool at_end() const { return m_position == m_end; }
+            unsigned digit() const { return at_end() ? 10u : static_cast<unsigned>(*m_position - '0'); }
+            bool is(const char c) const { return !at_end() && *m_position == c; }
+            char character() const { return at_end() ? '\0' : *m_position; }
+            void next() { ++m_position; }
+            const char* position() const { return m_position; }
+            std::size_t remaining() const { return static_cast<std::size_t>(m_end - m_position); }
+            void advance(const std::size_t count) { m_position += count; }
+
+            std::size_t skip_digits(const std::size_t limit)
+            {
+                const std::size_t available = static_cast<std::size_t>(m_end - m_position);
+                const char* stop = find_non_digit(m_position, m_position + (limit < available ? limit : available));
+                const auto skipped = static_cast<std::size_t>(stop - m_position);
+                m_position = stop;
+                return skipped;
+            }
+
+        private:
+            const char* m_position;
+            const char* m_end;
+        };
+
+        // Wraps another cursor and keeps a copy of the characters it consumes, so that the token can be
+        //  passed to event callbacks. Only the first 64 characters are kept.
+        template <typename Cursor>
+        class recording_cursor
+        {
+        public:
+            explicit recording_cursor(Cursor& in) : m_in{ in } {}
+
+            bool at_end() const { return m_in.at_end(); }
+            unsigned digit() const { return m_in.digit(); }
+            bool is(const char c) const { return m_in.is(c); }
+            char character() const { return m_in.character(); }
+
+            void next()
+            {
+                if (m_size < sizeof(m_text))
+                    m_text[m_size++] = character();
+                m_in.next();
+            }
+
+            std::size_t skip_digits(const std::size_t limit)
+            {
+                std::size_t skipped = 0;
+                for (; skipped < limit && digit() <= 9; ++skipped)
+                    next();
+                return skipped;
+            }
+
+            std::string_view text() const
+            {
+                return std::string_view(m_text, m_size);
+            }
+
+        private:
+            Cursor& m_in;
+            char m_text[64];
+            std::size_t m_size = 0;
+        };
+
+        // Accumulates decimal digits directly into the destination's width. Leading zeros are skipped.
+        //  The first digits10 significant digits can't overflow, the next one is checked with a single
+        //  comparison, and any more must overflow. Once overflow is certain, the remaining digits are
+        //  skipped in bulk unless the policy needs the low bits of the magnitude (i.e. to wrap). The
+        //  policy's length limits are applied throughout, and budget is what remains of the length.
+        template <typename Unsigned, typename Policy, typename Cursor>
+        void parse_magnitude(Cursor& in, parsed_token<Unsigned>& token, std::size_t& budget)
+        {
+            // Narrow types are accumulated in a full register, which lets the checked digit be tested
+            //  with one comparison instead of a division.
+            using register_type = typename std::conditional<(sizeof(Unsigned) < sizeof(unsigned)), unsigned, Unsigned>::type;
+            constexpr unsigned safe_digits = std::numeric_limits<Unsigned>::digits10;
+            constexpr register_type max = std::numeric_limits<Unsigned>::max();
+            constexpr bool limited = Policy::max_token_length != unlimited;
+            constexpr bool keep_low_bits = Policy::overflow == overflow_mode::wrap || Policy::overflow == overflow_mode::unchecked;
+
+            // Consumes the current character, unless that would exceed the length limit.
+            const auto consume = [&in, &token, &budget]
+            {
+                if constexpr (limited)
+                {
+                    if (budget == 0)
+                    {
+                        token.too_long = true;
+                        return false;
+                    }
+                    --budget;
+                }
+                in.next();
+                return true;
+            };
+
+            unsigned digit = in.digit();
+            if (digit > 9)
+                return;
+            token.valid = true;
+
+            std::size_t zeros = 0;
+            while (digit == 0)
+            {
+                if constexpr (Policy::max_leading_zeros != unlimited)
+                {
+                    if (zeros > Policy::max_leading_zeros)
+                    {
+                        token.too_long = true;
+                        return;
+                    }
+                }
+                if (!consume())
+                    return;
+                ++zeros;
+                digit = in.digit();
+            }
+            if constexpr (Policy::max_leading_zeros != unlimited)
+            {
+                if (zeros > Policy::max_leading_zeros && digit <= 9)
+                {
+                    token.too_long = true;
+                    return;
+                }
+            }
+
+            register_type value = 0;
+            for (unsigned count = 0; count < safe_digits && digit <= 9; ++count)
+            {
+                if (!consume())
+                    return;
+                value = static_cast<register_type>(value * 10 + digit);
+                digit = in.digit();
+            }
+
+            if (digit <= 9)
+            {
+                if (!consume())
+                    return;
+                if constexpr (sizeof(register_type) > sizeof(Unsigned))
+                    token.too_big = value * 10 + digit > max;
+                else
+                    token.too_big = value > (max - digit) / 10;
+                value = static_cast<register_type>(value * 10 + digit);
+                digit = in.digit();
+
+                if (digit <= 9)
+                {
+                    token.too_big = true;
+                    if constexpr (keep_low_bits)
+                    {
+                        for (; digit <= 9; digit = in.digit())
+                        {
+                            if (!consume())
+                                return;
+                            value = static_cast<register_type>(value * 10 + digit);
+                        }
+                    }
+                    else
+                    {
+                        budget -= in.skip_digits(budget);
+                        if (limited && in.digit() <= 9)
+                        {
+                            token.too_long = true;
+                            return;
+                        }
+                    }
+                }
+            }
+
+            token.magnitude = static_cast<Unsigned>(value);
+        }
+
+        // In the strict grammar, consumes the delimiter or newline which must follow a token, and
+        //  invalidates the token if something else follows it.
+        template <typename Policy, typename Unsigned, typename Cursor>
+        void consume_terminator(Cursor& in, parsed_token<Unsigned>& token)
+        {
+            if constexpr (Policy::grammar == input_grammar::strict)
+            {
+                if (token.valid && !token.too_long)
+                {
+                    if (in.is(Policy::delimiter) || in.is('\n'))
+                        in.next();
+                    else if (!in.at_end())
+                        token.valid = false;
+                }
+            }
+        }
+
+        // The human input grammar is parsed by a state machine. Each character is looked up in a table
+        //  to find its class, and the class and the current state select the next state.
+        enum human_class : std::uint8_t
+        {
+            human_digit,
+            human_separator,    // ' or _
+            human_sign,         // + or -
+            human_suffix,       // k, K, M, G, T, P or E
+            human_binary,       // i, which makes the suffix a power of 1024
+            human_other,
+            human_class_count
+        };
+
+        enum human_state : std::uint8_t
+        {
+            human_start,
+            human_signed,       // After the sign.
+            human_integer,      // After a digit.
+            human_grouped,      // After a separator, which must be followed by a digit.
+            human_scaled,       // After a suffix letter.
+            human_binary_scaled,// After a suffix letter and i.
+            human_stop,         // The token ends before the current character.
+            human_reject        // The token is invalid.
+        };
+
+        constexpr std::array<std::uint8_t, 256> human_classes = []
+        {
+            std::array<std::uint8_t, 256> classes{};
+            for (auto& c : classes)
+                c = human_other;
+            for (unsigned char c = '0'; c <= '9'; ++c)
+                classes[c] = human_digit;
+            for (const unsigned char c : { '\'', '_' })
+                classes[c] = human_separator;
+            for (const unsigned char c : { '+', '-' })
+                classes[c] = human_sign;
+            for (const unsigned char c : { 'k', 'K', 'M', 'G', 'T', 'P', 'E' })
+                classes[c] = human_suffix;
+            classes['i'] = human_binary;
+            return classes;
+        }();
+
+        constexpr human_state human_transitions[human_stop][human_class_count] =
+        {
+            //                      digit          separator      sign           suffix         binary               other
+            /* start */           { human_integer, human_reject,  human_signed,  human_reject,  human_reject,        human_reject },
+            /* signed */          { human_integer, human_reject,  human_reject,  human_reject,  human_reject,        human_reject },
+            /* integer */         { human_integer, human_grouped, human_stop,    human_scaled,  human_stop,          human_stop },
+            /* grouped */         { human_integer, human_reject,  human_reject,  human_reject,  human_reject,        human_reject },
+            /* scaled */          { human_stop,    human_stop,    human_stop,    human_stop,    human_binary_scaled, human_stop },
+            /* binary_scaled */   { human_stop,    human_stop,    human_stop,    human_stop,    human_stop,          human_stop },
+        };
+
+        // The power of 1000 (or 1024) which a suffix letter stands for.
+        constexpr unsigned suffix_exponent(const char c)
+        {
+            switch (c)
+            {
+            case 'M': return 2;
+            case 'G': return 3;
+            case 'T': return 4;
+            case 'P': return 5;
+            case 'E': return 6;
+            default: return 1;
+            }
+        }
+
+        // Parses a token in the human grammar in one pass, accumulating digits directly into the
+        //  destination's width and then applying the suffix's multiplier, with overflow checks at each
+        //  step. The length limit counts every character, including separators and the suffix.
+        template <typename Unsigned, typename Policy, typename Cursor>
+        parsed_token<Unsigned> parse_human_token(Cursor& in)
+        {
+            constexpr Unsigned max = std::numeric_limits<Unsigned>::max();
+            parsed_token<Unsigned> token;
+            std::size_t budget = Policy::max_token_length;
+            unsigned exponent = 0;
+            bool binary = false;
+
+            for (human_state state = human_start; ; )
+            {
+                const char c = in.character();
+                const human_state next = human_transitions[state][human_classes[static_cast<unsigned char>(c)]];
+                if (next == human_stop)
+                    break;
+                if (next == human_reject)
+                {
+                    token.valid = false;
+                    return token;
+                }
+
+                if constexpr (Policy::max_token_length != unlimited)
+                {
+                    if (budget == 0)
+                    {
+                        token.too_long = true;
+                        return token;
+                    }
+                    --budget;
+                }
+
+                switch (next)
+                {
+                case human_signed:
+                    token.negative = c == '-';
+                    break;
+                case human_integer:
+                {
+                    const auto digit = static_cast<unsigned>(c - '0');
+                    token.too_big |= token.magnitude > max / 10 || (token.magnitude == max / 10 && digit > max % 10);
+                    token.magnitude = static_cast<Unsigned>(token.magnitude * 10u + digit);
+                    token.valid = true;
+                    break;
+                }
+                case human_scaled:
+                    exponent = suffix_exponent(c);
+                    break;
+                case human_binary_scaled:
+                    binary = true;
+                    break;
+                default:
+                    break;
+                }
+                in.next();
+                state = next;
+            }
+
+            const unsigned base = binary ? 1024 : 1000;
+            for (unsigned i = 0; i < exponent; ++i)
+            {
+                token.too_big |= token.magnitude > max / base;
+                token.magnitude = static_cast<Unsigned>(token.magnitude * base);
+            }
+            return token;
+        }
+
+        // Parses a sign followed by digits in the policy's radix, which is not 10. Each character is
+        //  looked up in a table of digit values. Leading zeros are skipped, the digits which can't
+        //  overflow are accumulated unchecked, and the rest are checked one at a time. A power of two
+        //  base shifts the digits in, and its overflow check is a shift too.
+        template <typename Unsigned, typename Policy, typename Cursor>
+        parsed_token<Unsigned> parse_radix_token(Cursor& in)
+        {
+            constexpr unsigned base = Policy::radix;
+            static_assert(base >= 2 && base <= 62, "the radix must be from 2 to 62");
+            static_assert(Policy::grammar != input_grammar::human, "the human grammar is only for radix 10");
+            constexpr bool strict = Policy::grammar == input_grammar::strict;
+            constexpr bool limited = Policy::max_token_length != unlimited;
+            constexpr Unsigned max = static_cast<Unsigned>(~Unsigned{ 0 });
+            constexpr auto& values = radix_values<base>;
+            parsed_token<Unsigned> token;
+            std::size_t budget = Policy::max_token_length;
+
+            const auto consume = [&in, &token, &budget]
+            {
+                if constexpr (limited)
+                {
+                    if (budget == 0)
+                    {
+                        token.too_long = true;
+                        return false;
+                    }
+                    --budget;
+                }
+                in.next();
+                return true;
+            };
+            const auto digit = [&in, &values] { return unsigned{ values[static_cast<unsigned char>(in.character())] }; };
+
+            if (in.is('-') || (!strict && in.is('+')))
+            {
+                token.negative = in.is('-');
+                if (!consume())
+                    return token;
+            }
+
+            unsigned d = digit();
+            if (d >= base)
+                return token;
+            token.valid = true;
+
+            std::size_t zeros = 0;
+            for (; d == 0; d = digit(), ++zeros)
+            {
+                if constexpr (Policy::max_leading_zeros != unlimited)
+                {
+                    if (zeros > Policy::max_leading_zeros)
+                    {
+                        token.too_long = true;
+                        return token;
+                    }
+                }
+                if (!consume())
+                    return token;
+            }
+            if constexpr (Policy::max_leading_zeros != unlimited)
+            {
+                if (zeros > Policy::max_leading_zeros && d < base)
+                {
+                    token.too_long = true;
+                    return token;
+                }
+            }
+
+            Unsigned value = 0;
+            for (unsigned count = 0; count < radix_safe_digits<base, Unsigned> && d < base; ++count, d = digit())
+            {
+                if (!consume())
+                    return token;
+                value = static_cast<Unsigned>(value * base + d);
+            }
+            for (; d < base; d = digit())
+            {
+                if (!consume())
+                    return token;
+                if constexpr (is_power_of_two(base))
+                {
+                    constexpr unsigned shift = log2_of(base);
+                    token.too_big |= (value >> (std::numeric_limits<Unsigned>::digits - shift)) != 0;
+                    value = static_cast<Unsigned>(value << shift | d);
+                }
+                else
+                {
+                    token.too_big |= value > (max - d) / base;
+                    value = static_cast<Unsigned>(value * base + d);
+                }
+            }
+
+            token.magnitude = value;
+            consume_terminator<Policy>(in, token);
+            return token;
+        }
+
+        // Parses a sign followed by decimal digits, within the policy's length limits. In the strict
+        //  grammar, only a minus sign is allowed, and the terminator is consumed too.
+        template <typename Unsigned, typename Policy, typename Cursor>
+        parsed_token<Unsigned> parse_token(Cursor& in)
+        {
+            if constexpr (Policy::grammar == input_grammar::human)
+                return parse_human_token<Unsigned, Policy>(in);
+            if constexpr (Policy::radix != 10)
+                return parse_radix_token<Unsigned, Policy>(in);
+
+            constexpr bool strict = Policy::grammar == input_grammar::strict;
+            parsed_token<Unsigned> token;
+            std::size_t budget = Policy::max_token_length;
+            if (in.is('-') || (!strict && in.is('+')))
+            {
+                if (budget == 0)
+                {
+                    token.too_long = true;
+                    return token;
+                }
+                token.negative = in.is('-');
+                in.next();
+                if (Policy::max_token_length != unlimited)
+                    --budget;
+            }
+
+            parse_magnitude<Unsigned, Policy>(in, token, budget);
+            consume_terminator<Policy>(in, token);
+            return token;
+        }
+
+        // Parses a fixed-point decimal, e.g. 123.45, into an integer count of units of 10^-Scale. The
+        //  integer part is accumulated as parse_token() does it, and the fraction digits carry on in
+        //  the same width, so the result is exact and nothing goes through floating point. A missing or
+        //  short fraction is padded with zeros, and any digits beyond the scale are rounded by the
+        //  policy's rounding mode. Rounding is applied to the magnitude, so it is symmetric about zero.
+        template <typename Unsigned, typename Policy, unsigned Scale, typename Cursor>
+        parsed_token<Unsigned> parse_fixed_token(Cursor& in)
+        {
+            constexpr bool strict = Policy::grammar == input_grammar::strict;
+            constexpr bool limited = Policy::max_token_length != unlimited;
+            constexpr auto mode = Policy::fixed_rounding;
+            constexpr Unsigned max = std::numeric_limits<Unsigned>::max();
+            parsed_token<Unsigned> token;
+            std::size_t budget = Policy::max_token_length;
+
+            const auto consume = [&in, &token, &budget]
+            {
+                if constexpr (limited)
+                {
+                    if (budget == 0)
+                    {
+                        token.too_long = true;
+                        return false;
+                    }
+                    --budget;
+                }
+                in.next();
+                return true;
+            };
+
+            // Appends a digit to the magnitude, keeping the low bits if it overflows.
+            const auto append = [&token](const unsigned digit)
+            {
+                if (token.magnitude > (max - digit) / 10)
+                    token.too_big = true;
+                token.magnitude = static_cast<Unsigned>(token.magnitude * 10u + digit);
+            };
+
+            if (in.is('-') || (!strict && in.is('+')))
+            {
+                token.negative = in.is('-');
+                if (!consume())
+                    return token;
+            }
+
+            parse_magnitude<Unsigned, Policy>(in, token, budget);
+            if (!token.valid || token.too_long)
+                return token;
+
+            unsigned fraction_digits = 0;
+            unsigned first_extra = 0;
+            bool sticky = false;
+            if (in.is('.'))
+            {
+                if (!consume())
+                    return token;
+                for (unsigned digit = in.digit(); digit <= 9; digit = in.digit())
+                {
+                    if (!consume())
+                        return token;
+                    if (fraction_digits < Scale)
+                        append(digit);
+                    else if (fraction_digits == Scale)
+                        first_extra = digit;
+                    else
+                        sticky |= digit != 0;
+                    if (fraction_digits <= Scale)
+                        ++fraction_digits;
+                }
+            }
+
+            for (; fraction_digits < Scale; ++fraction_digits)
+                append(0);
+
+            if constexpr (mode == rounding::exact)
+            {
+                if (first_extra != 0 || sticky)
+                    token.valid = false;
+            }
+            else if constexpr (mode != rounding::toward_zero)
+            {
+                const bool round_up = mode == rounding::half_away
+                    ? first_extra >= 5
+                    : first_extra > 5 || (first_extra == 5 && (sticky || (token.magnitude & 1) != 0));
+                if (round_up)
+                {
+                    token.too_big |= token.magnitude == max;
+                    ++token.magnitude;
+                }
+            }
+
+            consume_terminator<Policy>(in, token);
+            return token;
+        }
+
+        // Reads a token using the stream's own number parsing. This handles other bases and locales
+        //  (e.g. digit grouping). Widths below 64 bits are read into a long long so that out-of-range
+        //  and negative values can be seen.
+        template <typename Integer, typename Elem, typename Traits>
+        auto read_token_with_num_get(std::basic_istream<Elem, Traits>& is)
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+            parsed_token<unsigned_type> token;
+            std::uint64_t magnitude;
+            bool overflowed;
+            if constexpr (std::is_signed<Integer>::value || sizeof(Integer) < sizeof(long long))
+            {
+                long long temp = 0;
+                is >> temp;
+                token.negative = temp < 0;
+                magnitude = token.negative ? 0 - static_cast<std::uint64_t>(temp) : static_cast<std::uint64_t>(temp);
+                token.valid = !(is.fail() && temp == 0);
+                overflowed = token.valid && is.fail();
+            }
+            else
+            {
+                // There is no wider type, so the sign has to be checked before the stream wraps it.
+                if (is.flags() & std::ios_base::skipws)
+                    is >> std::ws;
+                token.negative = Traits::eq_int_type(is.peek(), Traits::to_int_type(is.widen('-')));
+
+                unsigned long long temp = 0;
+                is >> temp;
+                magnitude = token.negative ? 0 - temp : temp;
+                token.valid = !(is.fail() && temp == 0);
+                overflowed = token.valid && is.fail();
+            }
+
+            // Range errors are the policy's decision, so don't let the stream's verdict stand.
+            if (overflowed)
+                is.clear(is.rdstate() & ~std::ios_base::failbit);
+
+            token.magnitude = static_cast<unsigned_type>(magnitude);
+            token.too_big = overflowed || magnitude > std::numeric_limits<unsigned_type>::max();
+            return token;
+        }
+
+        // Raises an event for a token. If the original text isn't given, it is rendered from the token
+        //  where possible.
+        template <typename Policy, typename Unsigned>
+        void raise_event(const input_event kind, const parsed_token<Unsigned>& token, const std::string_view text)
+        {
+            if constexpr (Policy::notify_events)
+            {
+                if (!text.empty() || token.too_big)
+                {
+                    raise_event<Policy>(kind, text);
+                    return;
+                }
+
+                char buffer[std::numeric_limits<Unsigned>::digits10 + 3] = { '-' };
+                const auto result = std::to_chars(buffer + 1, buffer + sizeof(buffer), token.magnitude);
+                const char* first = token.negative ? buffer : buffer + 1;
+                raise_event<Policy>(kind, std::string_view(first, static_cast<std::size_t>(result.ptr - first)));
+            }
+            else
+            {
+                raise_event<Policy>(kind);
+            }
+        }
+
+        // Stores a token in the destination according to the policy's overflow mode, and says what (if
+        //  anything) went wrong. The token's text is optional, and only used for events.
+        template <typename Policy, typename Integer>
+        parse_error fit_integer(const parsed_token<typename std::make_unsigned<Integer>::type>& token, Integer& value, const std::string_view text = {})
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+            constexpr auto max_magnitude = static_cast<unsigned_type>(std::numeric_limits<Integer>::max());
+            constexpr auto mode = Policy::overflow;
+
+            if (token.too_long)
+            {
+                raise_event<Policy>(input_event::too_long, text);
+                if constexpr (mode != overflow_mode::fail_only)
+                    value = 0;
+                return parse_error::too_long;
+            }
+
+            if (!token.valid)
+            {
+                raise_event<Policy>(input_event::parse_failure, text);
+                if constexpr (mode != overflow_mode::fail_only)
+                    value = 0;
+                return parse_error::invalid;
+            }
+
+            // Two's complement truncation of the token. This is the right answer whenever the token is
+            //  in range, and is also what wrapping means.
+            const auto truncated = static_cast<Integer>(token.negative ? static_cast<unsigned_type>(0 - token.magnitude) : token.magnitude);
+
+            if constexpr (mode == overflow_mode::unchecked)
+            {
+                value = truncated;
+                return parse_error::none;
+            }
+            else
+            {
+                const bool in_range = !token.too_big && (token.negative
+                    ? (std::is_signed<Integer>::value ? token.magnitude <= static_cast<unsigned_type>(max_magnitude + 1) : token.magnitude == 0)
+                    : token.magnitude <= max_magnitude);
+                if (in_range)
+                {
+                    value = truncated;
+                    return parse_error::none;
+                }
+
+                if constexpr (mode == overflow_mode::fail_only)
+                {
+                    raise_event<Policy>(input_event::out_of_range, token, text);
+                    return parse_error::out_of_range;
+                }
+
+                if constexpr (mode == overflow_mode::wrap)
+                {
+                    value = truncated;
+                    raise_event<Policy>(input_event::wrap, token, text);
+                    return parse_error::wrapped;
+                }
+
+                if constexpr (mode == overflow_mode::stream)
+                {
+                    if (!std::is_signed<Integer>::value)
+                    {
+                        // A negative number is allowed to wrap around to positive, as long as its
+                        //  magnitude is less than the maximum representable value. Any negative
+                        //  numbers with a larger magnitude are out of bounds, and become the maximum.
+                        if (token.negative && !token.too_big)
+                        {
+                            value = truncated;
+                            raise_event<Policy>(input_event::wrap, token, text);
+                            return parse_error::wrapped;
+                        }
+                        value = std::numeric_limits<Integer>::max();
+                        raise_event<Policy>(input_event::clamp, token, text);
+                        return parse_error::overflow_clamped;
+                    }
+                }
+
+                value = token.negative ? std::numeric_limits<Integer>::min() : std::numeric_limits<Integer>::max();
+                raise_event<Policy>(input_event::clamp, token, text);
+                return parse_error::overflow_clamped;
+            }
+        }
+
+        // True if the stream should fail after the given error. Wrapping is not a failure.
+        constexpr bool is_failure(const parse_error error)
+        {
+            return error != parse_error::none && error != parse_error::wrapped;
+        }
+
+        // The stream's iword slot which remembers whether it has the classic locale, because getloc()
+        //  copies the locale and comparing locales can compare their names.
+        inline int locale_slot()
+        {
+            static const int slot = std::ios_base::xalloc();
+            return slot;
+        }
+
+        enum locale_state : long
+        {
+            locale_callback_registered = 1,
+            locale_known = 2,
+            locale_classic = 4,
+        };
+
+        inline void forget_locale(const std::ios_base::event event, std::ios_base& stream, const int slot)
+        {
+            if (event != std::ios_base::erase_event)
+                stream.iword(slot) &= ~long{ locale_known };
+        }
+
+        template <typename Elem, typename Traits>
+        bool has_classic_locale(std::basic_ios<Elem, Traits>& stream)
+        {
+            long& state = stream.iword(locale_slot());
+            if (!(state & locale_known))
+            {
+                if (!(state & locale_callback_registered))
+                    stream.register_callback(&forget_locale, locale_slot());
+                state = locale_callback_registered | locale_known | (stream.getloc() == std::locale::classic() ? long{ locale_classic } : 0L);
+            }
+            return (state & locale_classic) != 0;
+        }
+
+        // True if the stream would parse plain decimal digits, which means num_get can be skipped.
+        //  Anything else (other bases, digit grouping, etc.) is left to the stream.
+        template <typename Elem, typename Traits>
+        bool is_plain_decimal(std::basic_istream<Elem, Traits>& is)
+        {
+            return (is.flags() & std::ios_base::basefield) == std::ios_base::dec && has_classic_locale(is);
+        }
+
+        // Extracts one token from a stream buffer whose stream has already passed its sentry, and
+        //  stores it according to the policy. Returns the state flags to set on the stream.
+        template <typename Policy, typename Integer, typename Elem, typename Traits>
+        std::ios_base::iostate extract_integer(std::basic_streambuf<Elem, Traits>* buffer, Integer& value)
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+
+            if constexpr (std::is_same<Elem, char>::value && !Policy::notify_events)
+            {
+                // Parse straight out of the get area if the token ends inside it. If it reaches the end
+                //  of the get area then it might continue, so it is parsed again from the buffer below.
+                using access = get_area_access<Elem, Traits>;
+                const char* first = access::current(buffer);
+                const auto available = static_cast<std::size_t>(access::end(buffer) - first);
+                pointer_cursor in{ first, first + (available < INT_MAX ? available : INT_MAX) };
+                const auto token = parse_token<unsigned_type, Policy>(in);
+                if (!in.at_end())
+                {
+                    access::advance(buffer, static_cast<int>(in.position() - first));
+                    return is_failure(fit_integer<Policy>(token, value)) ? std::ios_base::failbit : std::ios_base::goodbit;
+                }
+            }
+
+            streambuf_cursor<Elem, Traits> in{ buffer };
+            bool fitted;
+            if constexpr (Policy::notify_events)
+            {
+                recording_cursor<streambuf_cursor<Elem, Traits>> recorder{ in };
+                const auto token = parse_token<unsigned_type, Policy>(recorder);
+                fitted = !is_failure(fit_integer<Policy>(token, value, recorder.text()));
+            }
+            else
+            {
+                fitted = !is_failure(fit_integer<Policy>(parse_token<unsigned_type, Policy>(in), value));
+            }
+
+            std::ios_base::iostate state = std::ios_base::goodbit;
+            if (in.at_end())
+                state |= std::ios_base::eofbit;
+            if (!fitted)
+                state |= std::ios_base::failbit;
+            return state;
+        }
+
+        // Skips whitespace as the classic locale defines it. Returns false if the end of the input is
+        //  reached.
+        template <typename Elem, typename Traits>
+        bool skip_whitespace(std::basic_streambuf<Elem, Traits>* buffer)
+        {
+            for (auto c = buffer->sgetc(); ; c = buffer->snextc())
+            {
+                if (Traits::eq_int_type(c, Traits::eof()))
+                    return false;
+
+                const Elem e = Traits::to_char_type(c);
+                if (e != Elem(' ') && (e < Elem('\t') || e > Elem('\r')))
+                    return true;
+            }
+        }
+
+        // True if input follows the stream's base and locale, falling back to num_get when they aren't
+        //  plain decimal. A policy's radix overrides the stream, and the stream can't read integers
+        //  wider than 64 bits at all.
+        template <typename Policy, typename Integer>
+        constexpr bool follows_stream_base = Policy::radix == 10 && sizeof(Integer) <= sizeof(std::uint64_t);
+
+        // Reads an integer of any width, applying the policy's grammar and overflow mode.
+        template <typename Policy, typename Integer, typename Elem, typename Traits>
+        void read_integer(std::basic_istream<Elem, Traits>& is, Integer& value)
+        {
+            if constexpr (follows_stream_base<Policy, Integer>)
+            {
+                if (!is_plain_decimal(is))
+                {
+                    if (is_failure(fit_integer<Policy>(read_token_with_num_get<Integer>(is), value)))
+                        is.setstate(std::ios_base::failbit);
+                    return;
+                }
+            }
+
+            const typename std::basic_istream<Elem, Traits>::sentry sentry{ is, Policy::grammar == input_grammar::strict };
+            if (!sentry)
+                return;
+
+            std::ios_base::iostate state;
+            try
+            {
+                state = extract_integer<Policy>(is.rdbuf(), value);
+            }
+            catch (...)
+            {
+                is.setstate(std::ios_base::badbit);
+                return;
+            }
+            is.setstate(state);
+        }
+
+        // Reads up to count integers, stopping at the first failure. Returns the number read.
+        template <typename Policy, typename Integer, typename Elem, typename Traits>
+        std::size_t read_integers(std::basic_istream<Elem, Traits>& is, Integer* const values, const std::size_t count)
+        {
+            std::size_t index = 0;
+            if (follows_stream_base<Policy, Integer> && !is_plain_decimal(is))
+            {
+                for (; index < count; ++index)
+                {
+                    read_integer<Policy>(is, values[index]);
+                    if (is.fail())
+                        break;
+                }
+                return index;
+            }
+
+            constexpr bool strict = Policy::grammar == input_grammar::strict;
+            const typename std::basic_istream<Elem, Traits>::sentry sentry{ is, strict };
+            if (!sentry)
+                return 0;
+
+            const bool skip = !strict && (is.flags() & std::ios_base::skipws);
+            std::ios_base::iostate state = std::ios_base::goodbit;
+            try
+            {
+                auto* const buffer = is.rdbuf();
+                for (; index < count; ++index)
+                {
+                    if (skip && !skip_whitespace(buffer))
+                    {
+                        state |= std::ios_base::eofbit | std::ios_base::failbit;
+                        break;
+                    }
+
+                    state |= extract_integer<Policy>(buffer, values[index]);
+                    if (state & std::ios_base::failbit)
+                        break;
+                }
+            }
+            catch (...)
+            {
+                is.setstate(std::ios_base::badbit);
+                return index;
+            }
+            is.setstate(state);
+            return index;
+        }
+
+        // Reads a fixed-point decimal as a count of units of 10^-Scale. The text is always decimal with
+        //  a '.' point, whatever the stream's base and locale, so it is read straight from the stream
+        //  buffer.
+        template <typename Policy, unsigned Scale, typename Integer, typename Elem, typename Traits>
+        void read_fixed(std::basic_istream<Elem, Traits>& is, Integer& value)
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+            const typename std::basic_istream<Elem, Traits>::sentry sentry{ is, Policy::grammar == input_grammar::strict };
+            if (!sentry)
+                return;
+
+            std::ios_base::iostate state = std::ios_base::goodbit;
+            try
+            {
+                streambuf_cursor<Elem, Traits> in{ is.rdbuf() };
+                bool fitted;
+                if constexpr (Policy::notify_events)
+                {
+                    recording_cursor<streambuf_cursor<Elem, Traits>> recorder{ in };
+                    const auto token = parse_fixed_token<unsigned_type, Policy, Scale>(recorder);
+                    fitted = !is_failure(fit_integer<Policy>(token, value, recorder.text()));
+                }
+                else
+                {
+                    fitted = !is_failure(fit_integer<Policy>(parse_fixed_token<unsigned_type, Policy, Scale>(in), value));
+                }
+                if (in.at_end())
+                    state |= std::ios_base::eofbit;
+                if (!fitted)
+                    state |= std::ios_base::failbit;
+            }
+            catch (...)
+            {
+                is.setstate(std::ios_base::badbit);
+                return;
+            }
+            is.setstate(state);
+        }
+    }
+
+    // Checks that text follows the strict input grammar: tokens of an optional minus sign and decimal
+    //  digits, each followed by the delimiter or a newline (except perhaps the last). Returns the
+    //  offset of the first character which breaks the grammar, or the size of the text if it's valid.
+    //  Runs of digits are checked 8 at a time.
+    inline std::size_t validate_strict(const std::string_view text, const char delimiter = ' ')
+    {
+        const char* const first = text.data();
+        const char* const last = first + text.size();
+        const char* position = first;
+        while (position != last)
+        {
+            const char* const token = position;
+            if (*position == '-')
+                ++position;
+
+            const char* const digits_end = detail::find_non_digit(position, last);
+            if (digits_end == position)
+                return static_cast<std::size_t>((position == last ? token : position) - first);
+
+            position = digits_end;
+            if (position == last)
+                break;
+            if (*position != delimiter && *position != '\n')
+                return static_cast<std::size_t>(position - first);
+            ++position;
+        }
+        return text.size();
+    }
+
+    // The outcome of parse().
+    template <typename Integer>
+    struct parse_result
+    {
+        Integer value;
+        parse_error error;
+
+        // The number of characters consumed, i.e. the offset where parsing stopped.
+        std::size_t consumed;
+
+        // True if the value can be used: it was in range or wrapped (as a stream would accept).
+        constexpr explicit operator bool() const
+        {
+            return !detail::is_failure(error);
+        }
+    };
+
+    // The outcome of parsing a sequence of integers.
+    struct bulk_parse_result
+    {
+        // The number of values stored before stopping.
+        std::size_t count;
+
+        // Why parsing stopped early, or parse_error::none if it didn't.
+        parse_error error;
+
+        // The number of characters consumed, i.e. the offset where parsing stopped.
+        std::size_t consumed;
+
+        explicit operator bool() const
+        {
+            return error == parse_error::none;
+        }
+    };
+
+    // Records which values failed during bulk parsing, so that parsing can carry on past them. There
+    //  is a bitmask with one bit per value, and a list with the details of each failure.
+    class error_map
+    {
+    public:
+        struct failure
+        {
+            std::size_t index;  // Which value failed.
+            parse_error error;
+            std::size_t offset; // Where the failed token started in the text.
+        };
+
+        // Clears all failures and makes room for the given number of values.
+        void reset(const std::size_t count)
+        {
+            m_mask.assign((count + 63) / 64, 0);
+            m_failures.clear();
+        }
+
+        void record(const std::size_t index, const parse_error error, const std::size_t offset)
+        {
+            m_mask[index / 64] |= std::uint64_t{ 1 } << (index % 64);
+            m_failures.push_back(failure{ index, error, offset });
+        }
+
+        bool failed(const std::size_t index) const
+        {
+            return index / 64 < m_mask.size() && (m_mask[index / 64] >> (index % 64)) & 1;
+        }
+
+        std::size_t failure_count() const
+        {
+            return m_failures.size();
+        }
+
+        // The failures in the order they occurred (i.e. in order of index).
+        const std::vector<failure>& failures() const
+        {
+            return m_failures;
+        }
+
+        // One bit per value, set if the value failed. Value i is bit (i % 64) of word (i / 64).
+        const std::vector<std::uint64_t>& mask() const
+        {
+            return m_mask;
+        }
+
+    private:
+        std::vector<std::uint64_t> m_mask;
+        std::vector<failure> m_failures;
+    };
+
+    namespace detail
+    {
+        constexpr bool is_space(const char c)
+        {
+            return c == ' ' || (c >= '\t' && c <= '\r');
+        }
+
+        // Counts the whitespace-separated tokens in some text, e.g. to size the output of a bulk parse
+        //  which should consume all of it. A token starts at each non-space after a space, and this
+        //  finds them 8 characters at a time.
+        inline std::size_t count_tokens(const std::string_view text)
+        {
+            const char* first = text.data();
+            const char* const last = first + text.size();
+            std::size_t tokens = 0;
+            bool after_space = true;
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+            constexpr std::uint64_t ones = 0x0101010101010101u;
+            constexpr std::uint64_t high_bits = 0x8080808080808080u;
+            for (; last - first >= 8; first += 8)
+            {
+                std::uint64_t chunk;
+                std::memcpy(&chunk, first, sizeof(chunk));
+
+                // Each byte's top bit is set for a space, or for \t to \r: at least 9 and below 14, which
+                //  adding to the low 7 bits tests without carrying into the next byte.
+                const std::uint64_t low = chunk & ~high_bits;
+                const std::uint64_t blanks = chunk ^ (ones * ' ');
+                const std::uint64_t not_blank = (((blanks & ~high_bits) + ~high_bits) | blanks) & high_bits;
+                const std::uint64_t control = (low + ones * (0x80 - '\t')) & ~(low + ones * (0x80 - '\r' - 1)) & ~chunk & high_bits;
+                const std::uint64_t spaces = (~not_blank & high_bits) | control;
+                const std::uint64_t starts = ~spaces & high_bits & (spaces << 8 | (after_space ? 0x80u : 0u));
+                tokens += static_cast<std::size_t>(((starts >> 7) * ones) >> 56);
+                after_space = (spaces >> 63) != 0;
+            }
+#endif
+            for (; first != last; ++first)
+            {
+                const bool space = is_space(*first);
+                tokens += !space && after_space;
+                after_space = space;
+            }
+            return tokens;
+        }
+
+        // Moves past the rest of a token which could not be parsed, so that the next one can be.
+        template <typename Policy>
+        void resynchronise(pointer_cursor& in)
+        {
+            if constexpr (Policy::grammar == input_grammar::strict)
+            {
+                while (!in.at_end() && !in.is(Policy::delimiter) && !in.is('\n'))
+                    in.next();
+                if (!in.at_end())
+                    in.next();
+            }
+            else
+            {
+                while (!in.at_end() && !is_space(*in.position()))
+                    in.next();
+            }
+        }
+
+        // Parses one token from memory and stores it according to the policy.
+        template <typename Policy, typename Integer>
+        parse_error parse_from(pointer_cursor& in, Integer& value)
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+            if constexpr (Policy::notify_events)
+            {
+                recording_cursor<pointer_cursor> recorder{ in };
+                const auto token = parse_token<unsigned_type, Policy>(recorder);
+                return fit_integer<Policy>(token, value, recorder.text());
+            }
+            else
+            {
+                return fit_integer<Policy>(parse_token<unsigned_type, Policy>(in), value);
+            }
+        }
+    }
+
+    namespace detail
+    {
+        // True if bulk parsing can try parse_byte_swar() first. Its tokens are short enough for any
+        //  length limit of 5 or more, and anything it can't handle goes through parse_from(). The
+        //  word it loads must be little-endian.
+        template <typename Policy, typename Integer>
+        constexpr bool uses_byte_swar = sizeof(Integer) == 1 && Policy::grammar != input_grammar::human && Policy::radix == 10 &&
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+            Policy::max_token_length >= 5 && Policy::max_leading_zeros >= 3;
+#else
+            false;
+#endif
+
+        // Parses a 1-byte integer without a loop: the next 4 characters are loaded as one word, a
+        //  SIMD-within-a-register test finds the digits, and the token's length comes from the first
+        //  non-digit. Returns false, having consumed nothing, unless the token is 1 to 3 digits (after
+        //  an optional minus sign) and is in range, and in the strict grammar is followed by the
+        //  delimiter or a newline (which is consumed too). The caller falls back to parse_from() for
+        //  everything else, including the last few characters of the text.
+        template <typename Policy, typename Integer>
+        bool parse_byte_swar(pointer_cursor& in, Integer& value)
+        {
+            const char* p = in.position();
+            const bool negative = std::is_signed<Integer>::value && in.is('-');
+            if (in.remaining() < 4u + negative)
+                return false;
+            p += negative;
+
+            std::uint32_t word;
+            std::memcpy(&word, p, sizeof(word));
+            const std::uint32_t digits = word ^ 0x30303030u;
+            const std::uint32_t non_digits = (((digits & 0x7F7F7F7Fu) + 0x76767676u) | digits) & 0x80808080u;
+            if ((non_digits & 0x80u) != 0 || non_digits == 0)
+                return false;
+
+            const unsigned length = least_significant_bit(non_digits) >> 3;
+            constexpr bool strict = Policy::grammar == input_grammar::strict;
+            if (strict && p[length] != Policy::delimiter && p[length] != '\n')
+                return false;
+
+            const std::uint32_t aligned = digits << (32 - 8 * length);
+            const unsigned magnitude = ((aligned >> 8) & 0xFF) * 100 + ((aligned >> 16) & 0xFF) * 10 + (aligned >> 24);
+            if (magnitude > static_cast<unsigned>(std::numeric_limits<Integer>::max()) + negative)
+                return false;
+
+            value = static_cast<Integer>(negative ? 0 - static_cast<int>(magnitude) : static_cast<int>(magnitude));
+            in.advance(negative + length + strict);
+            return true;
+        }
+    }
+
+    // Parses an integer from the start of some text, without exceptions, streams or locales. The
+    //  policy's grammar, length limits and overflow mode apply as they do for stream input, except
+    //  that leading whitespace is not skipped. The value is set as the stream would set it, and
+    //  wrapped values are reported but not treated as failures.
+    template <typename Integer, typename Policy = default_policy>
+    parse_result<Integer> parse(const std::string_view text)
+    {
+        static_assert(std::is_integral<Integer>::value, "parse() requires an integer type");
+        static_assert(std::is_base_of<default_policy, Policy>::value, "parse() requires a policy derived from default_policy");
+        const detail::latency_scope<Policy> timer{ operation::parse };
+        detail::pointer_cursor in{ text.data(), text.data() + text.size() };
+        parse_result<Integer> result{};
+        result.error = detail::parse_from<Policy>(in, result.value);
+        result.consumed = static_cast<std::size_t>(in.position() - text.data());
+        return result;
+    }
+
+    // Parses a fixed-point decimal from the start of some text as a count of units of 10^-Scale,
+    //  e.g. parse_fixed<2, std::int64_t>("123.45") gives 12345. Otherwise it behaves as parse() does,
+    //  and extra fraction digits are rounded according to the policy's fixed_rounding.
+    template <unsigned Scale, typename Integer, typename Policy = default_policy>
+    parse_result<Integer> parse_fixed(const std::string_view text)
+    {
+        static_assert(std::is_integral<Integer>::value, "parse_fixed() requires an integer type");
+        static_assert(std::is_base_of<default_policy, Policy>::value, "parse_fixed() requires a policy derived from default_policy");
+        static_assert(Scale <= static_cast<unsigned>(std::numeric_limits<Integer>::digits10), "the scale leaves no room for an integer part");
+        using unsigned_type = typename std::make_unsigned<Integer>::type;
+        const detail::latency_scope<Policy> timer{ operation::parse };
+        detail::pointer_cursor in{ text.data(), text.data() + text.size() };
+        parse_result<Integer> result{};
+        if constexpr (Policy::notify_events)
+        {
+            detail::recording_cursor<detail::pointer_cursor> recorder{ in };
+            const auto token = detail::parse_fixed_token<unsigned_type, Policy, Scale>(recorder);
+            result.error = detail::fit_integer<Policy>(token, result.value, recorder.text());
+        }
+        else
+        {
+            result.error = detail::fit_integer<Policy>(detail::parse_fixed_token<unsigned_type, Policy, Scale>(in), result.value);
+        }
+        result.consumed = static_cast<std::size_t>(in.position() - text.data());
+        return result;
+    }
+
+    // Parses up to count integers from some text, stopping at the first failure. In the stream
+    //  grammar, whitespace is skipped before each value. In the strict grammar, each value must be
+    //  followed by the delimiter, a newline, or the end of the text. The failed value (if any) is
+    //  set as the stream would set it.
+    template <typename Policy = default_policy, typename Integer>
+    bulk_parse_result parse(const std::string_view text, Integer* const values, const std::size_t count)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "parse() requires a policy derived from default_policy; the bulk overloads take it first, as in parse<Policy>(text, values, count)");
+        static_assert(std::is_integral<Integer>::value, "parse() requires an integer type");
+        const detail::latency_scope<Policy> timer{ operation::bulk_parse };
+        INTEGRAL_IO_PROBE1(batch_begin, count);
+        detail::pointer_cursor in{ text.data(), text.data() + text.size() };
+
+        bulk_parse_result result{ 0, parse_error::none, 0 };
+        for (; result.count < count; ++result.count)
+        {
+            if constexpr (Policy::grammar == input_grammar::stream)
+            {
+                while (!in.at_end() && detail::is_space(*in.position()))
+                    in.next();
+            }
+            if constexpr (detail::uses_byte_swar<Policy, Integer>)
+            {
+                if (detail::parse_byte_swar<Policy>(in, values[result.count]))
+                    continue;
+            }
+
+            const parse_error error = detail::parse_from<Policy>(in, values[result.count]);
+            if (detail::is_failure(error))
+            {
+                result.error = error;
+                break;
+            }
+        }
+
+        result.consumed = static_cast<std::size_t>(in.position() - text.data());
+        INTEGRAL_IO_PROBE2(batch_end, result.count, count);
+        return result;
+    }
+
+    // As above, but carries on past values which fail. Each failure is recorded in the error map,
+    //  and the failed value is replaced with the policy's failed_value(). Parsing only stops early if
+    //  the text runs out, in which case the result's error is parse_error::invalid.
+    template <typename Policy = default_policy, typename Integer>
+    bulk_parse_result parse(const std::string_view text, Integer* const values, const std::size_t count, error_map& errors)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "parse() requires a policy derived from default_policy; the bulk overloads take it first, as in parse<Policy>(text, values, count)");
+        static_assert(std::is_integral<Integer>::value, "parse() requires an integer type");
+        const detail::latency_scope<Policy> timer{ operation::bulk_parse };
+        INTEGRAL_IO_PROBE1(batch_begin, count);
+        errors.reset(count);
+        detail::pointer_cursor in{ text.data(), text.data() + text.size() };
+
+        bulk_parse_result result{ 0, parse_error::none, 0 };
+        for (; result.count < count; ++result.count)
+        {
+            if constexpr (Policy::grammar == input_grammar::stream)
+            {
+                while (!in.at_end() && detail::is_space(*in.position()))
+                    in.next();
+            }
+            if (in.at_end())
+            {
+                result.error = parse_error::invalid;
+                break;
+            }
+
+            const auto offset = static_cast<std::size_t>(in.position() - text.data());
+            Integer& value = values[result.count];
+            const parse_error error = detail::parse_from<Policy>(in, value);
+            if (detail::is_failure(error))
+            {
+                errors.record(result.count, error, offset);
+                value = Policy::failed_value(value);
+                if (error == parse_error::invalid || error == parse_error::too_long)
+                    detail::resynchronise<Policy>(in);
+            }
+        }
+
+        result.consumed = static_cast<std::size_t>(in.position() - text.data());
+        INTEGRAL_IO_PROBE2(batch_end, result.count, count);
+        return result;
+    }
+
+    namespace detail
+    {
+        // Pairs of decimal digits from "00" to "99", for formatting two digits at a time.
+        inline constexpr char digit_pairs[201] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+        // The most characters needed to write an integer of the given type in decimal.
+        template <typename Integer>
+        constexpr std::size_t max_decimal_length = std::numeric_limits<Integer>::digits10 + 1 + (std::is_signed<Integer>::value ? 1 : 0);
+
+        // Writes the decimal digits of an unsigned value backwards, ending just before last. Returns a
+        //  pointer to the first digit. This is constexpr, so the same code formats compile-time constants.
+        template <typename Unsigned>
+        constexpr char* format_digits_backwards(char* last, Unsigned value)
+        {
+            while (value >= 100)
+            {
+                const auto pair = static_cast<std::size_t>(value % 100) * 2;
+                value = static_cast<Unsigned>(value / 100);
+                *--last = digit_pairs[pair + 1];
+                *--last = digit_pairs[pair];
+            }
+            if (value >= 10)
+            {
+                const auto pair = static_cast<std::size_t>(value) * 2;
+                *--last = digit_pairs[pair + 1];
+                *--last = digit_pairs[pair];
+            }
+            else
+            {
+                *--last = static_cast<char>('0' + value);
+            }
+            return last;
+        }
+
+        // Writes an integer in decimal backwards, ending just before last. Returns a pointer to the
+        //  first character. 1-byte integers are written as numbers, like everything else.
+        template <typename Integer>
+        constexpr char* format_integer_backwards(char* last, const Integer value)
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+            if constexpr (std::is_signed<Integer>::value)
+            {
+                if (value < 0)
+                {
+                    char* first = format_digits_backwards(last, static_cast<unsigned_type>(0 - static_cast<unsigned_type>(value)));
+                    *--first = '-';
+                    return first;
+                }
+            }
+            return format_digits_backwards(last, static_cast<unsigned_type>(value));
+        }
+
+        // Writes an integer in decimal backwards in the given notation, ending just before last.
+        //  Returns a pointer to the first character. The suffixed forms need at most one more
+        //  character than the plain form.
+        template <output_notation Notation, typename Integer>
+        constexpr char* format_suffixed_backwards(char* last, const Integer value)
+        {
+            if constexpr (Notation == output_notation::plain)
+            {
+                return format_integer_backwards(last, value);
+            }
+            else
+            {
+                using unsigned_type = typename std::make_unsigned<Integer>::type;
+                constexpr unsigned base = Notation == output_notation::si ? 1000 : 1024;
+                bool negative = false;
+                if constexpr (std::is_signed<Integer>::value)
+                    negative = value < 0;
+                auto magnitude = static_cast<unsigned_type>(negative ? 0 - static_cast<unsigned_type>(value) : static_cast<unsigned_type>(value));
+
+                unsigned exponent = 0;
+                while (magnitude != 0 && magnitude % base == 0 && exponent < 6)
+                {
+                    magnitude = static_cast<unsigned_type>(magnitude / base);
+                    ++exponent;
+                }
+                if (exponent != 0)
+                {
+                    if constexpr (Notation == output_notation::iec)
+                        *--last = 'i';
+                    *--last = (Notation == output_notation::si ? "kMGTPE" : "KMGTPE")[exponent - 1];
+                }
+
+                char* first = format_digits_backwards(last, magnitude);
+                if (negative)
+                    *--first = '-';
+                return first;
+            }
+        }
+
+        // Writes exactly Count digits of a chunk backwards, with leading zeros.
+        template <unsigned Base, unsigned Count, typename Chunk>
+        constexpr char* format_radix_chunk_backwards(char* last, Chunk chunk)
+        {
+            for (unsigned i = 0; i < Count; ++i)
+            {
+                *--last = radix_alphabet<Base>[static_cast<std::size_t>(chunk % Base)];
+                chunk = static_cast<Chunk>(chunk / Base);
+            }
+            return last;
+        }
+
+        // Writes the digits of an unsigned value in any base from 2 to 62 backwards, ending just before
+        //  last, with leading zeros to make at least min_digits. Returns a pointer to the first digit.
+        //  Powers of two are written by shifting. Other bases split off chunks of as many digits as fit
+        //  in the next narrower width with one division each (by Base^k), so a 128-bit value is
+        //  brought down to 64 bits, and a 64-bit value to 32 bits, before the per-digit divisions.
+        //  Division by a constant is a multiplication, and a 32-bit one is the cheapest of all.
+        template <unsigned Base, typename Unsigned>
+        constexpr char* format_radix_digits_backwards(char* last, Unsigned magnitude, const std::size_t min_digits)
+        {
+            static_assert(Base >= 2 && Base <= 62, "the radix must be from 2 to 62");
+            char* const padded = last - min_digits;
+            if constexpr (is_power_of_two(Base))
+            {
+                constexpr unsigned shift = log2_of(Base);
+                do
+                {
+                    *--last = radix_alphabet<Base>[static_cast<std::size_t>(magnitude & (Base - 1))];
+                    magnitude = static_cast<Unsigned>(magnitude >> shift);
+                } while (magnitude != 0);
+            }
+            else
+            {
+                std::uint64_t wide;
+                if constexpr (sizeof(Unsigned) > sizeof(std::uint64_t))
+                {
+                    constexpr Unsigned divisor = radix_chunk<Base, std::uint64_t>;
+                    while (magnitude > std::numeric_limits<std::uint64_t>::max())
+                    {
+                        last = format_radix_chunk_backwards<Base, radix_safe_digits<Base, std::uint64_t>>(last, static_cast<std::uint64_t>(magnitude % divisor));
+                        magnitude = static_cast<Unsigned>(magnitude / divisor);
+                    }
+                }
+                wide = static_cast<std::uint64_t>(magnitude);
+
+                if constexpr (sizeof(Unsigned) > sizeof(std::uint32_t))
+                {
+                    constexpr std::uint64_t divisor = radix_chunk<Base, std::uint32_t>;
+                    while (wide > std::numeric_limits<std::uint32_t>::max())
+                    {
+                        last = format_radix_chunk_backwards<Base, radix_safe_digits<Base, std::uint32_t>>(last, static_cast<std::uint32_t>(wide % divisor));
+                        wide /= divisor;
+                    }
+                }
+
+                auto narrow = static_cast<std::uint32_t>(wide);
+                do
+                {
+                    *--last = radix_alphabet<Base>[narrow % Base];
+                    narrow /= Base;
+                } while (narrow != 0);
+            }
+            while (last > padded)
+                *--last = '0';
+            return last;
+        }
+
+        // True if the policy formats this integer type itself, rather than leaving it to the stream:
+        //  with suffixes, in a radix other than 10, zero-padded, or wider than the stream can handle.
+        template <typename Policy, typename Integer>
+        constexpr bool custom_format = Policy::notation != output_notation::plain || Policy::radix != 10 ||
+            Policy::radix_width != 0 || sizeof(Integer) > sizeof(std::uint64_t);
+
+        // An upper bound on the length of a custom-formatted integer: every bit as a digit, the
+        //  padding, and a sign and suffix.
+        template <typename Policy, typename Integer>
+        constexpr std::size_t custom_format_length = std::numeric_limits<typename std::make_unsigned<Integer>::type>::digits + Policy::radix_width + 2;
+
+        // Writes an integer backwards as the policy's notation, radix and width say, ending just before
+        //  last. Returns a pointer to the first character.
+        template <typename Policy, typename Integer>
+        constexpr char* format_custom_backwards(char* last, const Integer value)
+        {
+            if constexpr (Policy::radix == 10 && Policy::radix_width == 0)
+            {
+                return format_suffixed_backwards<Policy::notation>(last, value);
+            }
+            else
+            {
+                static_assert(Policy::notation == output_notation::plain, "suffixes can only be written in radix 10, without a radix_width");
+                using unsigned_type = typename std::make_unsigned<Integer>::type;
+                bool negative = false;
+                if constexpr (std::is_signed<Integer>::value)
+                    negative = value < 0;
+                const auto magnitude = static_cast<unsigned_type>(negative ? 0 - static_cast<unsigned_type>(value) : static_cast<unsigned_type>(value));
+                char* first = format_radix_digits_backwards<Policy::radix>(last, magnitude, Policy::radix_width);
+                if (negative)
+                    *--first = '-';
+                return first;
+            }
+        }
+
+        // Writes the digits of an unsigned value in a power-of-two base (2 to the power of shift)
+        //  backwards, ending just before last. Returns a pointer to the first digit.
+        template <typename Unsigned>
+        char* format_radix_backwards(char* last, Unsigned value, const unsigned shift, const bool upper_case)
+        {
+            const char* const digits = upper_case ? "0123456789ABCDEF" : "0123456789abcdef";
+            const Unsigned mask = static_cast<Unsigned>((1u << shift) - 1);
+            do
+            {
+                *--last = digits[value & mask];
+                value = static_cast<Unsigned>(value >> shift);
+            } while (value != 0);
+            return last;
+        }
+
+        // A parsed standard format spec for integers: [[fill]align][sign][#][0][width][type], where the
+        //  type is one of b, B, o, d, x or X, or '\0' if there isn't one.
+        template <typename CharT>
+        struct format_spec
+        {
+            CharT fill = CharT(' ');
+            char align = '\0';
+            char sign = '-';
+            bool alternate = false;
+            bool zero_pad = false;
+            std::size_t width = 0;
+            char type = '\0';
+        };
+
+        // Parses a format spec, up to the closing brace. Returns an error message, or nullptr if it is
+        //  valid. This is constexpr, so std::format and {fmt} can check format strings at compile time.
+        template <typename Iterator, typename CharT>
+        constexpr const char* parse_format_spec(Iterator& it, const Iterator last, format_spec<CharT>& spec)
+        {
+            const auto is_align = [](const CharT c) { return c == CharT('<') || c == CharT('>') || c == CharT('^'); };
+            if (it == last || *it == CharT('}'))
+                return nullptr;
+            Iterator next = it;
+            ++next;
+            if (next != last && is_align(*next))
+            {
+                if (*it == CharT('{') || *it == CharT('}'))
+                    return "invalid fill character";
+                spec.fill = *it;
+                spec.align = static_cast<char>(*next);
+                it = ++next;
+            }
+            else if (is_align(*it))
+            {
+                spec.align = static_cast<char>(*it);
+                ++it;
+            }
+            if (it != last && (*it == CharT('+') || *it == CharT('-') || *it == CharT(' ')))
+            {
+                spec.sign = static_cast<char>(*it);
+                ++it;
+            }
+            if (it != last && *it == CharT('#'))
+            {
+                spec.alternate = true;
+                ++it;
+            }
+            if (it != last && *it == CharT('0'))
+            {
+                spec.zero_pad = true;
+                ++it;
+            }
+            for (; it != last && *it >= CharT('0') && *it <= CharT('9'); ++it)
+            {
+                spec.width = spec.width * 10 + static_cast<std::size_t>(*it - CharT('0'));
+                if (spec.width > 0xffff)
+                    return "width is too large";
+            }
+            if (it != last && *it == CharT('{'))
+                return "dynamic width is not supported";
+            if (it != last && (*it == CharT('b') || *it == CharT('B') || *it == CharT('o') || *it == CharT('d') || *it == CharT('x') || *it == CharT('X')))
+            {
+                spec.type = static_cast<char>(*it);
+                ++it;
+            }
+            if (it != last && *it != CharT('}'))
+                return "invalid format spec for an integer";
+            return nullptr;
+        }
+
+        // Writes a sign or prefix (the lead) and some digits, padded as a format spec says. Zero padding
+        //  goes between the lead and the digits.
+        template <typename CharT, typename OutputIt>
+        OutputIt write_padded(OutputIt out, const char* const lead, const std::size_t lead_length, const char* const first, const char* const last, const format_spec<CharT>& spec)
+        {
+            const std::size_t length = lead_length + static_cast<std::size_t>(last - first);
+            const std::size_t padding = spec.width > length ? spec.width - length : 0;
+            std::size_t before = 0, zeros = 0, after = 0;
+            if (spec.align == '\0' && spec.zero_pad)
+                zeros = padding;
+            else if (spec.align == '<')
+                after = padding;
+            else if (spec.align == '^')
+                after = padding - (before = padding / 2);
+            else
+                before = padding;
+
+            out = std::fill_n(out, before, spec.fill);
+            out = std::transform(lead, lead + lead_length, out, [](const char c) { return static_cast<CharT>(c); });
+            out = std::fill_n(out, zeros, CharT('0'));
+            out = std::transform(first, last, out, [](const char c) { return static_cast<CharT>(c); });
+            return std::fill_n(out, after, spec.fill);
+        }
+
+        // Writes an integer to an output iterator as described by a format spec. Negative numbers are
+        //  written as a sign and magnitude in every base, as std::format does.
+        template <typename Integer, typename CharT, typename OutputIt>
+        OutputIt format_with_spec(OutputIt out, const Integer value, const format_spec<CharT>& spec)
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+            bool negative = false;
+            if constexpr (std::is_signed<Integer>::value)
+                negative = value < 0;
+            const unsigned_type magnitude = negative ? static_cast<unsigned_type>(0 - static_cast<unsigned_type>(value)) : static_cast<unsigned_type>(value);
+
+            char buffer[std::numeric_limits<unsigned_type>::digits];
+            char* const last = buffer + sizeof(buffer);
+            const char* first = nullptr;
+            const char* prefix = "";
+            switch (spec.type)
+            {
+            case 'b': first = format_radix_backwards(last, magnitude, 1, false); prefix = "0b"; break;
+            case 'B': first = format_radix_backwards(last, magnitude, 1, false); prefix = "0B"; break;
+            case 'o': first = format_radix_backwards(last, magnitude, 3, false); prefix = magnitude != 0 ? "0" : ""; break;
+            case 'x': first = format_radix_backwards(last, magnitude, 4, false); prefix = "0x"; break;
+            case 'X': first = format_radix_backwards(last, magnitude, 4, true); prefix = "0X"; break;
+            default: first = format_digits_backwards(last, magnitude); break;
+            }
+
+            char lead[4] = {};
+            std::size_t lead_length = 0;
+            if (negative)
+                lead[lead_length++] = '-';
+            else if (spec.sign != '-')
+                lead[lead_length++] = spec.sign;
+            for (; spec.alternate && *prefix != '\0'; ++prefix)
+                lead[lead_length++] = *prefix;
+            return write_padded(out, lead, lead_length, first, last, spec);
+        }
+
+        // The library-independent part of the std::formatter and fmt::formatter specialisations below.
+        template <typename CharT>
+        struct wrapper_formatter
+        {
+            template <typename Iterator>
+            constexpr const char* parse(Iterator& it, const Iterator last)
+            {
+                return parse_format_spec(it, last, m_spec);
+            }
+
+            // Without an explicit type, values are written in the policy's notation and radix, as the
+            //  stream operators write them; fill, alignment, width, sign and zero padding still apply.
+            //  An explicit type (including d) overrides the policy's notation and radix.
+            template <typename Policy, typename Integer, typename OutputIt>
+            OutputIt format(OutputIt out, const Integer value) const
+            {
+                const latency_scope<Policy> timer{ operation::format };
+                using io_type = integral_io_t<Integer>;
+                if constexpr (custom_format<Policy, io_type>)
+                {
+                    if (m_spec.type == '\0')
+                    {
+                        char buffer[custom_format_length<Policy, io_type>];
+                        char* const last = buffer + sizeof(buffer);
+                        const char* first = format_custom_backwards<Policy>(last, static_cast<io_type>(value));
+                        char lead = '\0';
+                        if (*first == '-')
+                            lead = *first++;
+                        else if (m_spec.sign != '-')
+                            lead = m_spec.sign;
+                        return write_padded(out, &lead, lead != '\0' ? 1 : 0, first, last, m_spec);
+                    }
+                }
+                return format_with_spec(out, static_cast<io_type>(value), m_spec);
+            }
+
+            format_spec<CharT> m_spec;
+        };
+
+        template <typename T>
+        struct is_optional : std::false_type {};
+
+        template <typename T>
+        struct is_optional<std::optional<T>> : std::true_type {};
+
+        template <typename T, typename = void>
+        struct is_tuple_like : std::false_type {};
+
+        template <typename T>
+        struct is_tuple_like<T, std::void_t<decltype(std::tuple_size<T>::value)>> : std::true_type {};
+
+        template <typename T, typename = void>
+        struct is_range : std::false_type {};
+
+        template <typename T>
+        struct is_range<T, std::void_t<decltype(std::begin(std::declval<const T&>())), decltype(std::end(std::declval<const T&>()))>> : std::true_type {};
+
+        template <typename T, typename = void>
+        struct is_map : std::false_type {};
+
+        template <typename T>
+        struct is_map<T, std::void_t<typename T::key_type, typename T::mapped_type>> : is_range<T> {};
+
+        // True for the containers and aggregates which as_integer() can write.
+        template <typename T>
+        struct is_composite : std::integral_constant<bool, !std::is_integral<T>::value &&
+            (is_optional<T>::value || is_tuple_like<T>::value || is_range<T>::value)> {};
+
+        template <typename T>
+        struct dependent_false : std::false_type {};
+
+        template <typename Policy, typename T>
+        void append_formatted(std::string& out, const T& value);
+
+        template <typename Policy, typename Tuple, std::size_t... Indices>
+        void append_tuple(std::string& out, const Tuple& value, std::index_sequence<Indices...>)
+        {
+            out += Policy::tuple_open;
+            ((out += (Indices == 0 ? std::string_view{} : Policy::element_separator), append_formatted<Policy>(out, std::get<Indices>(value))), ...);
+            out += Policy::tuple_close;
+        }
+
+        // Appends an integer, container or aggregate (recursively) to a string.
+        template <typename Policy, typename T>
+        void append_formatted(std::string& out, const T& value)
+        {
+            if constexpr (std::is_integral<T>::value)
+            {
+                char buffer[custom_format_length<Policy, integral_io_t<T>>];
+                char* const last = buffer + sizeof(buffer);
+                const char* const first = format_custom_backwards<Policy>(last, static_cast<integral_io_t<T>>(value));
+                out.append(first, static_cast<std::size_t>(last - first));
+            }
+            else if constexpr (is_optional<T>::value)
+            {
+                if (value)
+                    append_formatted<Policy>(out, *value);
+                else
+                    out += Policy::empty_optional;
+            }
+            else if constexpr (is_map<T>::value)
+            {
+                out += Policy::map_open;
+                bool first = true;
+                for (const auto& element : value)
+                {
+                    if (!first)
+                        out += Policy::element_separator;
+                    first = false;
+                    append_formatted<Policy>(out, element.first);
+                    out += Policy::key_separator;
+                    append_formatted<Policy>(out, element.second);
+                }
+                out += Policy::map_close;
+            }
+            else if constexpr (is_range<T>::value)
+            {
+                out += Policy::sequence_open;
+                bool first = true;
+                for (const auto& element : value)
+                {
+                    if (!first)
+                        out += Policy::element_separator;
+                    first = false;
+                    append_formatted<Policy>(out, element);
+                }
+                out += Policy::sequence_close;
+            }
+            else if constexpr (is_tuple_like<T>::value)
+            {
+                append_tuple<Policy>(out, value, std::make_index_sequence<std::tuple_size<T>::value>{});
+            }
+            else
+            {
+                static_assert(dependent_false<T>::value, "as_integer() can only write integers, and containers, tuples and optionals of them");
+            }
+        }
+
+        // Writes formatted text to a stream in one go, widening it first if necessary.
+        template <typename Elem, typename Traits>
+        void write_formatted(std::basic_ostream<Elem, Traits>& os, const std::string_view text)
+        {
+            if constexpr (std::is_same<Elem, char>::value)
+            {
+                os.write(text.data(), static_cast<std::streamsize>(text.size()));
+            }
+            else
+            {
+                std::basic_string<Elem, Traits> widened(text.size(), Elem());
+                std::use_facet<std::ctype<Elem>>(os.getloc()).widen(text.data(), text.data() + text.size(), &widened[0]);
+                os.write(widened.data(), static_cast<std::streamsize>(widened.size()));
+            }
+        }
+
+        // Writes formatted text for a single value as one field, so that the stream's width, fill and
+        //  adjustment apply to the whole of it.
+        template <typename Elem, typename Traits>
+        void write_field(std::basic_ostream<Elem, Traits>& os, const std::string_view text)
+        {
+            if constexpr (std::is_same<Elem, char>::value)
+            {
+                os << text;
+            }
+            else
+            {
+                std::basic_string<Elem, Traits> widened(text.size(), Elem());
+                std::use_facet<std::ctype<Elem>>(os.getloc()).widen(text.data(), text.data() + text.size(), &widened[0]);
+                os << widened;
+            }
+        }
+    }
+
+    namespace detail
+    {
+        // A pre-rendered decimal string, for the output tables.
+        template <typename Integer>
+        struct rendered_integer
+        {
+            char text[max_decimal_length<integral_io_t<Integer>>];
+            std::uint8_t length;
+        };
+
+        template <typename Integer>
+        constexpr std::size_t table_size = std::size_t{ 1 } << (sizeof(Integer) * CHAR_BIT);
+
+        // Renders every value of a 1-byte or 2-byte integer type, indexed by its unsigned representation.
+        template <typename Integer>
+        constexpr void render_all(rendered_integer<Integer>* const table)
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+            for (std::size_t i = 0; i < table_size<Integer>; ++i)
+            {
+                auto& entry = table[i];
+                char* const last = entry.text + sizeof(entry.text);
+                const char* const first = format_integer_backwards(last, static_cast<integral_io_t<Integer>>(static_cast<Integer>(static_cast<unsigned_type>(i))));
+                entry.length = static_cast<std::uint8_t>(last - first);
+                for (std::size_t j = 0; j < entry.length; ++j)
+                    entry.text[j] = first[j];
+            }
+        }
+
+        template <typename Integer>
+        constexpr std::array<rendered_integer<Integer>, table_size<Integer>> render_table()
+        {
+            std::array<rendered_integer<Integer>, table_size<Integer>> table{};
+            render_all<Integer>(table.data());
+            return table;
+        }
+
+        // The 1-byte tables are built at compile time. The 2-byte tables are too big for compilers to
+        //  build quickly, so they are built the first time they're used. Either way, the tables are
+        //  only instantiated (and so only take up space) for the types which use them.
+        template <typename Integer>
+        inline constexpr auto byte_table = render_table<Integer>();
+
+        template <typename Integer>
+        const rendered_integer<Integer>* rendered_table()
+        {
+            if constexpr (sizeof(Integer) == 1)
+            {
+                return byte_table<Integer>.data();
+            }
+            else
+            {
+                static const std::vector<rendered_integer<Integer>> table = []
+                {
+                    std::vector<rendered_integer<Integer>> rendered(table_size<Integer>);
+                    render_all<Integer>(rendered.data());
+                    return rendered;
+                }();
+                return table.data();
+            }
+        }
+
+        template <typename Integer>
+        using table_key = typename std::conditional<std::is_signed<Integer>::value,
+            typename std::conditional<sizeof(Integer) == 1, std::int8_t, std::int16_t>::type,
+            typename std::conditional<sizeof(Integer) == 1, std::uint8_t, std::uint16_t>::type>::type;
+
+        // True if the policy renders this integer type from a table.
+        template <typename Policy, typename Integer>
+        constexpr bool uses_table = (sizeof(Integer) == 1 && Policy::table != output_table::none) ||
+            (sizeof(Integer) == 2 && Policy::table == output_table::bytes_and_shorts);
+
+        // True if the stream would write plain decimal digits with nothing around them.
+        template <typename Elem, typename Traits>
+        bool is_plain_decimal_output(std::basic_ostream<Elem, Traits>& os)
+        {
+            return (os.flags() & (std::ios_base::basefield | std::ios_base::showpos)) == std::ios_base::dec && os.width() == 0 && has_classic_locale(os);
+        }
+
+        template <typename Integer>
+        constexpr bool is_negative(const Integer value)
+        {
+            if constexpr (std::is_signed<Integer>::value)
+                return value < 0;
+            else
+                return false;
+        }
+
+        template <typename Integer>
+        constexpr std::uint64_t magnitude_of(const Integer value)
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+            return is_negative(value) ? static_cast<unsigned_type>(0 - static_cast<unsigned_type>(value)) : static_cast<unsigned_type>(value);
+        }
+
+        // Writes one integer as the stream would, using the policy's output table when possible.
+        //  Custom formats are formatted here and written as one field. Suffixes are only written in
+        //  base 10, but a policy's radix overrides the stream's base. Anything else is streamed as a
+        //  Streamed.
+        template <typename Policy, typename Integer, typename Elem, typename Traits, typename Streamed = integral_io_t<Integer>>
+        void write_integer(std::basic_ostream<Elem, Traits>& os, const Integer value)
+        {
+            if constexpr (custom_format<Policy, Integer>)
+            {
+                constexpr bool follows_stream_base = Policy::radix == 10 && Policy::radix_width == 0 && sizeof(Integer) <= sizeof(std::uint64_t);
+                if (!follows_stream_base || (os.flags() & std::ios_base::basefield) == std::ios_base::dec)
+                {
+                    const auto io_value = static_cast<integral_io_t<Integer>>(value);
+                    char buffer[custom_format_length<Policy, integral_io_t<Integer>> + 1];
+                    char* const last = buffer + sizeof(buffer);
+                    char* first = format_custom_backwards<Policy>(last, io_value);
+                    if ((os.flags() & std::ios_base::showpos) && !is_negative(io_value))
+                        *--first = '+';
+                    write_field(os, std::string_view(first, static_cast<std::size_t>(last - first)));
+                    return;
+                }
+            }
+
+            // The stream can't write wider integers, so they are always custom-formatted above.
+            if constexpr (sizeof(Integer) <= sizeof(std::uint64_t))
+            {
+                if constexpr (std::is_same<Elem, char>::value && uses_table<Policy, Integer>)
+                {
+                    if (is_plain_decimal_output(os))
+                    {
+                        const typename std::basic_ostream<Elem, Traits>::sentry sentry{ os };
+                        if (!sentry)
+                            return;
+                        const auto& entry = rendered_table<table_key<Integer>>()[static_cast<typename std::make_unsigned<table_key<Integer>>::type>(value)];
+                        try
+                        {
+                            if (os.rdbuf()->sputn(entry.text, entry.length) != entry.length)
+                                os.setstate(std::ios_base::badbit);
+                        }
+                        catch (...)
+                        {
+                            os.setstate(std::ios_base::badbit);
+                        }
+                        return;
+                    }
+                }
+                os << static_cast<Streamed>(value);
+            }
+        }
+
+        // The number of characters needed for a sequence of integers, not counting delimiters.
+        template <typename Policy, typename Integer>
+        std::size_t count_characters(const Integer* const values, const std::size_t count)
+        {
+            using io_type = integral_io_t<Integer>;
+            std::size_t i = 0;
+            std::size_t characters = 0;
+            if constexpr (custom_format<Policy, Integer>)
+            {
+                // Custom formats are rare enough in bulk that each value is simply formatted.
+                char buffer[custom_format_length<Policy, io_type>];
+                char* const last = buffer + sizeof(buffer);
+                for (; i < count; ++i)
+                    characters += static_cast<std::size_t>(last - format_custom_backwards<Policy>(last, static_cast<io_type>(values[i])));
+                return characters;
+            }
+            else if constexpr (sizeof(Integer) == 8)
+            {
+                initialise_kernels();
+                if (const count_characters_function kernel = count_characters_kernel.load(std::memory_order_relaxed))
+                {
+                    characters = kernel(values, count / 8, std::is_signed<Integer>::value);
+                    i = count / 8 * 8;
+                }
+            }
+            for (; i < count; ++i)
+            {
+                const auto value = static_cast<io_type>(values[i]);
+                characters += decimal_digits(magnitude_of(value)) + (is_negative(value) ? 1 : 0);
+            }
+            return characters;
+        }
+
+        // How far format_values() may write beyond the end of its text, unless Exact is set.
+        constexpr std::size_t format_slack = 24;
+
+        // Formats one integer left to right (its digits are written right to left, once the number of
+        //  digits is known) and returns the end. Unless Exact is set, a table entry is copied whole.
+        template <typename Policy, bool Exact, typename Integer>
+        char* format_value(char* out, const Integer input)
+        {
+            const auto value = static_cast<integral_io_t<Integer>>(input);
+            if constexpr (custom_format<Policy, Integer>)
+            {
+                char buffer[custom_format_length<Policy, integral_io_t<Integer>>];
+                char* const last = buffer + sizeof(buffer);
+                const char* const first = format_custom_backwards<Policy>(last, value);
+                std::memcpy(out, first, static_cast<std::size_t>(last - first));
+                return out + (last - first);
+            }
+            else if constexpr (!Exact && uses_table<Policy, Integer>)
+            {
+                const auto& entry = rendered_table<table_key<Integer>>()[static_cast<typename std::make_unsigned<table_key<Integer>>::type>(value)];
+                std::memcpy(out, entry.text, sizeof(entry.text));
+                return out + entry.length;
+            }
+            else
+            {
+                if (is_negative(value))
+                    *out++ = '-';
+                const std::uint64_t magnitude = magnitude_of(value);
+                out += decimal_digits(magnitude);
+                format_digits_backwards(out, magnitude);
+                return out;
+            }
+        }
+
+        // Formats a sequence of integers, each followed by the policy's delimiter, and returns the end.
+        //  There are no bounds checks, so the caller provides enough room, including format_slack
+        //  bytes beyond the end unless Exact is set. Integers of 4 bytes or more are formatted 8 at a
+        //  time when the kernel has a batch formatter and Exact isn't set.
+        template <typename Policy, bool Exact, typename Integer>
+        char* format_values(char* out, const Integer* const values, const std::size_t count)
+        {
+            std::size_t i = 0;
+            if constexpr (!Exact && sizeof(Integer) >= 4 && !custom_format<Policy, Integer>)
+            {
+                initialise_kernels();
+                if (const render_decimal_function render = render_decimal_kernel.load(std::memory_order_relaxed))
+                {
+                    constexpr std::size_t batch = 8;
+                    constexpr std::size_t field = 24;
+                    alignas(64) char digits[batch * field + field];
+                    for (; count - i >= batch; i += batch)
+                    {
+                        std::uint64_t magnitudes[batch];
+                        for (std::size_t j = 0; j < batch; ++j)
+                            magnitudes[j] = magnitude_of(static_cast<integral_io_t<Integer>>(values[i + j]));
+                        render(magnitudes, digits);
+                        for (std::size_t j = 0; j < batch; ++j)
+                        {
+                            if (is_negative(values[i + j]))
+                                *out++ = '-';
+                            const unsigned length = decimal_digits(magnitudes[j]);
+                            std::memcpy(out, digits + field * (j + 1) - length, field);
+                            out += length;
+                            *out++ = Policy::delimiter;
+                        }
+                    }
+                }
+            }
+            for (; i < count; ++i)
+            {
+                out = format_value<Policy, Exact>(out, values[i]);
+                *out++ = Policy::delimiter;
+            }
+            return out;
+        }
+
+        // Writes a sequence of integers separated by the policy's delimiter. For char streams with
+        //  default formatting, the text is built in a local buffer and handed to the stream buffer a
+        //  few KB at a time.
+        template <typename Policy, typename Integer, typename Elem, typename Traits>
+        void write_integers(std::basic_ostream<Elem, Traits>& os, const Integer* const values, const std::size_t count)
+        {
+            if constexpr (std::is_same<Elem, char>::value)
+            {
+                if (is_plain_decimal_output(os))
+                {
+                    const typename std::basic_ostream<Elem, Traits>::sentry sentry{ os };
+                    if (!sentry)
+                        return;
+
+                    constexpr std::size_t capacity = 4096;
+                    constexpr std::size_t length = custom_format<Policy, Integer> ? custom_format_length<Policy, integral_io_t<Integer>> : max_decimal_length<integral_io_t<Integer>>;
+                    constexpr std::size_t chunk = capacity / (length + 1) > 0 ? capacity / (length + 1) : 1;
+                    char buffer[capacity + format_slack];
+                    try
+                    {
+                        for (std::size_t i = 0; i < count; i += chunk)
+                        {
+                            const std::size_t n = count - i < chunk ? count - i : chunk;
+                            const char* last = format_values<Policy, false>(buffer, values + i, n);
+                            // Leave off the delimiter after the last value.
+                            if (i + n == count)
+                                --last;
+                            const auto size = static_cast<std::streamsize>(last - buffer);
+                            INTEGRAL_IO_PROBE1(buffer_refill, size);
+                            if (os.rdbuf()->sputn(buffer, size) != size)
+                            {
+                                os.setstate(std::ios_base::badbit);
+                                return;
+                            }
+                        }
+                    }
+                    catch (...)
+                    {
+                        os.setstate(std::ios_base::badbit);
+                    }
+                    return;
+                }
+            }
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (i != 0)
+                    os.put(os.widen(Policy::delimiter));
+                write_integer<Policy>(os, values[i]);
+            }
+        }
+    }
+
+    // Compile-time formatting and parsing, with the same semantics as the wrappers: 1-byte integers
+    //  are numbers, not characters.
+
+    // The number of characters needed to write an integer in decimal.
+    template <typename Integer>
+    constexpr std::size_t formatted_length(const Integer value)
+    {
+        char buffer[detail::max_decimal_length<integral_io_t<Integer>>]{};
+        char* const last = buffer + sizeof(buffer);
+        return static_cast<std::size_t>(last - detail::format_integer_backwards(last, static_cast<integral_io_t<Integer>>(value)));
+    }
+
+    // Formats a constant in decimal, without a terminating null, e.g. format_constant<std::uint8_t{ 200 }>().
+    template <auto Value>
+    constexpr std::array<char, formatted_length(Value)> format_constant()
+    {
+        static_assert(std::is_integral<decltype(Value)>::value, "format_constant() requires an integer");
+        std::array<char, formatted_length(Value)> text{};
+        detail::format_integer_backwards(text.data() + text.size(), static_cast<integral_io_t<decltype(Value)>>(Value));
+        return text;
+    }
+
+    // Parses a whole string as a decimal integer: an optional '-' followed by digits, and nothing
+    //  else. Values which don't fit are rejected with parse_error::out_of_range, leaving the value 0.
+    template <typename Integer>
+    constexpr parse_result<Integer> parse_constant(const std::string_view text)
+    {
+        static_assert(std::is_integral<Integer>::value, "parse_constant() requires an integer type");
+        using limits = std::numeric_limits<Integer>;
+        parse_result<Integer> result{};
+        std::size_t i = 0;
+        const bool negative = !text.empty() && text[0] == '-';
+        if (negative)
+            ++i;
+        const std::uintmax_t limit = !negative ? static_cast<std::uintmax_t>(limits::max()) :
+            limits::is_signed ? static_cast<std::uintmax_t>(limits::max()) + 1 : 0;
+        const std::size_t first_digit = i;
+        std::uintmax_t magnitude = 0;
+        bool too_big = false;
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i)
+        {
+            const auto digit = static_cast<std::uintmax_t>(text[i] - '0');
+            if (too_big || digit > limit || magnitude > (limit - digit) / 10)
+                too_big = true;
+            else
+                magnitude = magnitude * 10 + digit;
+        }
+        result.consumed = i;
+        if (i == first_digit || i != text.size())
+            result.error = parse_error::invalid;
+        else if (too_big)
+            result.error = parse_error::out_of_range;
+        else if (negative && magnitude != 0)
+            result.value = static_cast<Integer>(-static_cast<std::intmax_t>(magnitude - 1) - 1);
+        else
+            result.value = static_cast<Integer>(magnitude);
+        return result;
+    }
+
+    template <typename Integer, std::size_t N>
+    constexpr parse_result<Integer> parse_constant(const std::array<char, N>& text)
+    {
+        return parse_constant<Integer>(std::string_view(text.data(), N));
+    }
+
+    namespace detail
+    {
+        // Parses the characters of a numeric literal, allowing digit separators but not leading zeros
+        //  (which C++ would treat as octal) or other bases.
+        template <typename Integer, char... Chars>
+        constexpr parse_result<Integer> parse_literal()
+        {
+            const char chars[] = { Chars... };
+            char digits[sizeof...(Chars)]{};
+            std::size_t length = 0;
+            for (const char c : chars)
+            {
+                if (c != '\'')
+                    digits[length++] = c;
+            }
+            if (length > 1 && digits[0] == '0')
+                return { Integer{}, parse_error::invalid, 0 };
+            return parse_constant<Integer>(std::string_view(digits, length));
+        }
+
+        template <typename Integer, char... Chars>
+        constexpr Integer numeric_literal()
+        {
+            constexpr auto result = parse_literal<Integer, Chars...>();
+            static_assert(result.error != parse_error::invalid, "integer literals must be decimal, without leading zeros");
+            static_assert(result.error != parse_error::out_of_range, "integer literal is out of range");
+            return result.value;
+        }
+
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+        // A string literal which can be a template argument, for the string forms of the literals.
+        template <std::size_t N>
+        struct fixed_string
+        {
+            constexpr fixed_string(const char (&text)[N])
+            {
+                for (std::size_t i = 0; i < N; ++i)
+                    m_text[i] = text[i];
+            }
+
+            constexpr std::string_view view() const
+            {
+                return std::string_view(m_text, N - 1);
+            }
+
+            char m_text[N]{};
+        };
+
+        template <typename Integer, fixed_string Text>
+        constexpr Integer string_literal()
+        {
+            constexpr auto result = parse_constant<Integer>(Text.view());
+            static_assert(result.error != parse_error::invalid, "integer literals must be decimal");
+            static_assert(result.error != parse_error::out_of_range, "integer literal is out of range");
+            return result.value;
+        }
+#endif
+    }
+
+    // User-defined literals which are checked at compile time, e.g. 200_u8 or (with C++20) "-128"_i8.
+    //  Note that -5_i8 is the int -5, as the minus is applied after the literal.
+    inline namespace literals
+    {
+        template <char... Chars>
+        constexpr std::int8_t operator""_i8()
+        {
+            return detail::numeric_literal<std::int8_t, Chars...>();
+        }
+
+        template <char... Chars>
+        constexpr std::uint8_t operator""_u8()
+        {
+            return detail::numeric_literal<std::uint8_t, Chars...>();
+        }
+
+        template <char... Chars>
+        constexpr std::int16_t operator""_i16()
+        {
+            return detail::numeric_literal<std::int16_t, Chars...>();
+        }
+
+        template <char... Chars>
+        constexpr std::uint16_t operator""_u16()
+        {
+            return detail::numeric_literal<std::uint16_t, Chars...>();
+        }
+
+        template <char... Chars>
+        constexpr std::int32_t operator""_i32()
+        {
+            return detail::numeric_literal<std::int32_t, Chars...>();
+        }
+
+        template <char... Chars>
+        constexpr std::uint32_t operator""_u32()
+        {
+            return detail::numeric_literal<std::uint32_t, Chars...>();
+        }
+
+        template <char... Chars>
+        constexpr std::int64_t operator""_i64()
+        {
+            return detail::numeric_literal<std::int64_t, Chars...>();
+        }
+
+        template <char... Chars>
+        constexpr std::uint64_t operator""_u64()
+        {
+            return detail::numeric_literal<std::uint64_t, Chars...>();
+        }
+
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+        template <detail::fixed_string Text>
+        constexpr std::int8_t operator""_i8()
+        {
+            return detail::string_literal<std::int8_t, Text>();
+        }
+
+        template <detail::fixed_string Text>
+        constexpr std::uint8_t operator""_u8()
+        {
+            return detail::string_literal<std::uint8_t, Text>();
+        }
+
+        template <detail::fixed_string Text>
+        constexpr std::int16_t operator""_i16()
+        {
+            return detail::string_literal<std::int16_t, Text>();
+        }
+
+        template <detail::fixed_string Text>
+        constexpr std::uint16_t operator""_u16()
+        {
+            return detail::string_literal<std::uint16_t, Text>();
+        }
+
+        template <detail::fixed_string Text>
+        constexpr std::int32_t operator""_i32()
+        {
+            return detail::string_literal<std::int32_t, Text>();
+        }
+
+        template <detail::fixed_string Text>
+        constexpr std::uint32_t operator""_u32()
+        {
+            return detail::string_literal<std::uint32_t, Text>();
+        }
 
-#if defined(min) || defined(max)
-#   error min() and max() macros must not be defined. For Windows, define NOMINMAX before including the Windows headers.
-#endif
+        template <detail::fixed_string Text>
+        constexpr std::int64_t operator""_i64()
+        {
+            return detail::string_literal<std::int64_t, Text>();
+        }
 
-namespace integral_io
-{
-    // Generic trait which handles any signed or unsigned integer which is bigger than 1 byte.
-    template <typename Integer, typename = std::enable_if_t<std::is_integral_v<Integer>, Integer>, std::size_t = sizeof(Integer), bool = std::is_signed<Integer>::value>
-    struct integral_io_trait
-    {
-        using type = Integer;
-    };
+        template <detail::fixed_string Text>
+        constexpr std::uint64_t operator""_u64()
+        {
+            return detail::string_literal<std::uint64_t, Text>();
+        }
+#endif
+    }
 
-    // Trait specialised for signed integers which are exactly 1 byte.
-    template <typename Integer>
-    struct integral_io_trait<Integer, Integer, 1, true>
+    namespace detail
     {
-        using type = std::int16_t;
-    };
+        template <typename Unsigned>
+        constexpr Unsigned power_of_ten(const unsigned exponent)
+        {
+            Unsigned power = 1;
+            for (unsigned i = 0; i < exponent; ++i)
+                power = static_cast<Unsigned>(power * 10);
+            return power;
+        }
 
-    // Trait specialised for unsigned integers which are exactly 1 byte.
-    template <typename Integer>
-    struct integral_io_trait<Integer, Integer, 1, false>
-    {
-        using type = std::uint16_t;
-    };
+        // Writes a count of units of 10^-Scale as a fixed-point decimal backwards, ending just before
+        //  last, e.g. 12345 with a scale of 2 is 123.45 and -5 is -0.05. Returns a pointer to the first
+        //  character. The fraction always has exactly Scale digits, and a scale of 0 has no point.
+        template <unsigned Scale, typename Integer>
+        constexpr char* format_fixed_backwards(char* last, const Integer value)
+        {
+            using unsigned_type = typename std::make_unsigned<Integer>::type;
+            constexpr auto unit = power_of_ten<unsigned_type>(Scale);
+            auto magnitude = static_cast<unsigned_type>(is_negative(value) ? 0 - static_cast<unsigned_type>(value) : static_cast<unsigned_type>(value));
+            char* first = last;
+            if constexpr (Scale > 0)
+            {
+                char* const point = last - Scale - 1;
+                first = format_digits_backwards(last, static_cast<unsigned_type>(magnitude % unit));
+                while (first != point + 1)
+                    *--first = '0';
+                *--first = '.';
+                magnitude = static_cast<unsigned_type>(magnitude / unit);
+            }
+            first = format_digits_backwards(first, magnitude);
+            if (is_negative(value))
+                *--first = '-';
+            return first;
+        }
 
-    // Helper template alias.
-    template <typename Integer>
-    using integral_io_t = typename integral_io_trait<Integer>::type;
+        // Writes a fixed-point decimal as one field, honouring the stream's showpos flag.
+        template <unsigned Scale, typename Elem, typename Traits, typename Integer>
+        void write_fixed(std::basic_ostream<Elem, Traits>& os, const Integer value)
+        {
+            char buffer[std::numeric_limits<typename std::make_unsigned<Integer>::type>::digits10 + 5];
+            char* const last = buffer + sizeof(buffer);
+            char* first = format_fixed_backwards<Scale>(last, value);
+            if ((os.flags() & std::ios_base::showpos) && !is_negative(value))
+                *--first = '+';
+            write_field(os, std::string_view(first, static_cast<std::size_t>(last - first)));
+        }
+    }
 
     // Generic output-only wrapper for signed and unsigned integers which are bigger than 1 byte.
-    template <typename Integer, typename = typename std::enable_if<std::is_integral<Integer>::value, Integer>::type, std::size_t = sizeof(Integer)>
+    template <typename Integer, typename Policy = default_policy, typename = typename std::enable_if<std::is_integral<Integer>::value, Integer>::type, std::size_t = sizeof(Integer)>
     struct integral_output_wrapper final
     {
         integral_output_wrapper(const Integer value) : m_value{ value } {}
@@ -47,15 +4011,16 @@ namespace integral_io
         template <typename Elem, typename Traits>
         void output(std::basic_ostream<Elem, Traits>& os) const
         {
-            os << m_value;
+            const detail::latency_scope<Policy> timer{ operation::format };
+            detail::write_integer<Policy>(os, m_value);
         }
 
         const Integer m_value;
     };
 
     // Output-only wrapper specialised for signed and unsigned integers which are exactly 1 byte.
-    template <typename Integer>
-    struct integral_output_wrapper<Integer, Integer, 1> final
+    template <typename Integer, typename Policy>
+    struct integral_output_wrapper<Integer, Policy, Integer, 1> final
     {
         integral_output_wrapper(const Integer value) : m_value{ value } {}
         integral_output_wrapper(integral_output_wrapper&) = default;
@@ -67,14 +4032,15 @@ namespace integral_io
         template <typename Elem, typename Traits>
         void output(std::basic_ostream<Elem, Traits>& os) const
         {
-            os << static_cast<integral_io_t<Integer>>(m_value);
+            const detail::latency_scope<Policy> timer{ operation::format };
+            detail::write_integer<Policy>(os, m_value);
         }
 
         const Integer m_value;
     };
 
     // Generic input/output wrapper for signed and unsigned integers which are bigger than 1 byte.
-    template <typename Integer, typename = typename std::enable_if<std::is_integral<Integer>::value, Integer>::type, std::size_t = sizeof(Integer), bool = std::is_signed<Integer>::value>
+    template <typename Integer, typename Policy = default_policy, typename = typename std::enable_if<std::is_integral<Integer>::value, Integer>::type, std::size_t = sizeof(Integer), bool = std::is_signed<Integer>::value>
     struct integral_io_wrapper
     {
         integral_io_wrapper(Integer& value) : m_value{ value } {}
@@ -87,21 +4053,23 @@ namespace integral_io
         template <typename Elem, typename Traits>
         void output(std::basic_ostream<Elem, Traits>& os) const
         {
-            os << m_value;
+            const detail::latency_scope<Policy> timer{ operation::format };
+            detail::write_integer<Policy>(os, m_value);
         }
 
         template <typename Elem, typename Traits>
         void input(std::basic_istream<Elem, Traits>& is)
         {
-            is >> m_value;
+            const detail::latency_scope<Policy> timer{ operation::parse };
+            detail::read_integer<Policy>(is, m_value);
         }
 
         Integer& m_value;
     };
 
     // Input/output wrapper specialised for signed integers which are exactly 1 byte.
-    template <typename Integer>
-    struct integral_io_wrapper<Integer, Integer, 1, true>
+    template <typename Integer, typename Policy>
+    struct integral_io_wrapper<Integer, Policy, Integer, 1, true>
     {
         integral_io_wrapper(Integer& value) : m_value{ value } {}
         integral_io_wrapper(integral_io_wrapper&) = default;
@@ -113,38 +4081,23 @@ namespace integral_io
         template <typename Elem, typename Traits>
         void output(std::basic_ostream<Elem, Traits>& os) const
         {
-            os << static_cast<std::int16_t>(m_value);
+            const detail::latency_scope<Policy> timer{ operation::format };
+            detail::write_integer<Policy>(os, m_value);
         }
 
         template <typename Elem, typename Traits>
         void input(std::basic_istream<Elem, Traits>& is)
         {
-            std::int16_t temp;
-            is >> temp;
-
-            // Emulate the stream's usual bounds-checking behaviour for signed types.
-            if (temp > static_cast<std::int16_t>(std::numeric_limits<Integer>::max()))
-            {
-                m_value = std::numeric_limits<Integer>::max();
-                is.setstate(std::ios_base::failbit);
-                return;
-            }
-            if (temp < static_cast<std::int16_t>(std::numeric_limits<Integer>::min()))
-            {
-                m_value = std::numeric_limits<Integer>::min();
-                is.setstate(std::ios_base::failbit);
-                return;
-            }
-
-            m_value = static_cast<Integer>(temp);
+            const detail::latency_scope<Policy> timer{ operation::parse };
+            detail::read_integer<Policy>(is, m_value);
         }
 
         Integer& m_value;
     };
 
     // Input/output wrapper specialised for unsigned integers which are exactly 1 byte.
-    template <typename Integer>
-    struct integral_io_wrapper<Integer, Integer, 1, false>
+    template <typename Integer, typename Policy>
+    struct integral_io_wrapper<Integer, Policy, Integer, 1, false>
     {
         integral_io_wrapper(Integer& value) : m_value{ value } {}
         integral_io_wrapper(integral_io_wrapper&) = default;
@@ -156,64 +4109,341 @@ namespace integral_io
         template <typename Elem, typename Traits>
         void output(std::basic_ostream<Elem, Traits>& os) const
         {
-            os << static_cast<std::int16_t>(m_value);
+            const detail::latency_scope<Policy> timer{ operation::format };
+            // This wrapper has always streamed through std::int16_t, so std::showpos gives "+200" here
+            //  but "200" from the output-only wrapper.
+            detail::write_integer<Policy, Integer, Elem, Traits, std::int16_t>(os, m_value);
+        }
+
+        template <typename Elem, typename Traits>
+        void input(std::basic_istream<Elem, Traits>& is)
+        {
+            const detail::latency_scope<Policy> timer{ operation::parse };
+            detail::read_integer<Policy>(is, m_value);
+        }
+
+        Integer& m_value;
+    };
+
+    // Output-only wrapper for a contiguous sequence of integers of any size. The values are separated
+    //  by the policy's delimiter.
+    template <typename Integer, typename Policy = default_policy>
+    struct integral_span_output_wrapper final
+    {
+        integral_span_output_wrapper(const Integer* values, const std::size_t count) : m_values{ values }, m_count{ count } {}
+        integral_span_output_wrapper(integral_span_output_wrapper&) = default;
+        integral_span_output_wrapper(integral_span_output_wrapper&&) = default;
+        integral_span_output_wrapper& operator=(const integral_span_output_wrapper&) = delete;
+        integral_span_output_wrapper& operator=(integral_span_output_wrapper&&) = delete;
+        ~integral_span_output_wrapper() = default;
+
+        template <typename Elem, typename Traits>
+        void output(std::basic_ostream<Elem, Traits>& os) const
+        {
+            const detail::latency_scope<Policy> timer{ operation::bulk_format };
+            INTEGRAL_IO_PROBE1(batch_begin, m_count);
+            detail::write_integers<Policy>(os, m_values, m_count);
+            INTEGRAL_IO_PROBE2(batch_end, m_count, m_count);
+        }
+
+        const Integer* const m_values;
+        const std::size_t m_count;
+    };
+
+    // Input/output wrapper for a contiguous sequence of integers of any size. Input stops at the first
+    //  failure, and m_read records how many values were read before it.
+    template <typename Integer, typename Policy = default_policy>
+    struct integral_span_io_wrapper
+    {
+        integral_span_io_wrapper(Integer* values, const std::size_t count) : m_values{ values }, m_count{ count } {}
+        integral_span_io_wrapper(integral_span_io_wrapper&) = default;
+        integral_span_io_wrapper(integral_span_io_wrapper&&) = default;
+        integral_span_io_wrapper& operator=(const integral_span_io_wrapper&) = delete;
+        integral_span_io_wrapper& operator=(integral_span_io_wrapper&&) = delete;
+        ~integral_span_io_wrapper() = default;
+
+        template <typename Elem, typename Traits>
+        void output(std::basic_ostream<Elem, Traits>& os) const
+        {
+            integral_span_output_wrapper<Integer, Policy>(m_values, m_count).output(os);
         }
 
         template <typename Elem, typename Traits>
         void input(std::basic_istream<Elem, Traits>& is)
         {
-            // We have to do signed input so that we can correctly handle negatives which wrap around.
-            // If we use unsigned then we won't be able to tell the difference between a positive value
-            //  which is too big, and a negative value which has wrapped round.
-            std::int16_t temp;
-            is >> temp;
+            const detail::latency_scope<Policy> timer{ operation::bulk_parse };
+            INTEGRAL_IO_PROBE1(batch_begin, m_count);
+            m_read = detail::read_integers<Policy>(is, m_values, m_count);
+            INTEGRAL_IO_PROBE2(batch_end, m_read, m_count);
+        }
+
+        Integer* const m_values;
+        const std::size_t m_count;
+        std::size_t m_read = 0;
+    };
+
+    // Output-only wrapper for containers and aggregates of integers (and of each other), e.g.
+    //  std::vector<std::int8_t> or std::map<int, std::pair<std::uint8_t, long>>. The whole value is
+    //  formatted into one buffer, and written to the stream in one go. Every integer is written as a
+    //  number, including 1-byte integers.
+    template <typename Composite, typename Policy = default_policy>
+    struct integral_composite_output_wrapper final
+    {
+        integral_composite_output_wrapper(const Composite& value) : m_value{ value } {}
+        integral_composite_output_wrapper(integral_composite_output_wrapper&) = default;
+        integral_composite_output_wrapper(integral_composite_output_wrapper&&) = default;
+        integral_composite_output_wrapper& operator=(const integral_composite_output_wrapper&) = delete;
+        integral_composite_output_wrapper& operator=(integral_composite_output_wrapper&&) = delete;
+        ~integral_composite_output_wrapper() = default;
+
+        template <typename Elem, typename Traits>
+        void output(std::basic_ostream<Elem, Traits>& os) const
+        {
+            const detail::latency_scope<Policy> timer{ operation::bulk_format };
+            std::string buffer;
+            detail::append_formatted<Policy>(buffer, m_value);
+            detail::write_formatted(os, buffer);
+        }
+
+        const Composite& m_value;
+    };
 
-            // We need to emulate the stream's usual bounds-checking behaviour for signed types.
-            if (temp > static_cast<std::int16_t>(std::numeric_limits<Integer>::max()))
+    namespace detail
+    {
+        // The width of a column: the longer of its smallest and largest values, as the number of
+        //  characters only grows with the magnitude. The min/max pass has no branches, so compilers
+        //  can vectorise it.
+        template <typename Integer>
+        std::size_t column_width(const Integer* const values, const std::size_t rows)
+        {
+            if (rows == 0)
+                return 0;
+            Integer low = values[0];
+            Integer high = values[0];
+            for (std::size_t i = 1; i < rows; ++i)
             {
-                m_value = std::numeric_limits<Integer>::max();
-                is.setstate(std::ios_base::failbit);
-                return;
+                low = values[i] < low ? values[i] : low;
+                high = values[i] > high ? values[i] : high;
             }
-            if (temp < 0)
+            const auto width = [](const Integer value)
+            {
+                const auto io_value = static_cast<integral_io_t<Integer>>(value);
+                return std::size_t{ decimal_digits(magnitude_of(io_value)) } + (is_negative(io_value) ? 1 : 0);
+            };
+            return std::max(width(low), width(high));
+        }
+
+        // Writes a value right-aligned in a cell of the given width, which it must fit. Returns the
+        //  end of the cell.
+        template <typename Policy, typename Integer>
+        char* format_cell(char* const out, const std::size_t width, const Integer value)
+        {
+            char* const last = out + width;
+            char* const first = format_integer_backwards(last, static_cast<integral_io_t<Integer>>(value));
+            for (char* fill = out; fill != first; ++fill)
+                *fill = Policy::fill;
+            return last;
+        }
+    }
+
+    // Output-only wrapper for a table of integer columns, which may each have a different type.
+    //  Each column is right-aligned to its widest value, and each row ends with a newline. The
+    //  column widths are found first, so rows are formatted into one buffer a block at a time
+    //  without any per-cell stream formatting.
+    template <typename Policy, typename... Integers>
+    struct integral_table_output_wrapper final
+    {
+        static_assert(sizeof...(Integers) > 0, "a table needs at least one column");
+        static_assert((std::is_integral<Integers>::value && ...), "table columns must be integers");
+        static_assert(((sizeof(Integers) <= sizeof(std::uint64_t)) && ...), "table columns must be at most 64 bits wide");
+
+        integral_table_output_wrapper(const std::size_t rows, const Integers*... columns) : m_rows{ rows }, m_columns{ columns... } {}
+        integral_table_output_wrapper(integral_table_output_wrapper&) = default;
+        integral_table_output_wrapper(integral_table_output_wrapper&&) = default;
+        integral_table_output_wrapper& operator=(const integral_table_output_wrapper&) = delete;
+        integral_table_output_wrapper& operator=(integral_table_output_wrapper&&) = delete;
+        ~integral_table_output_wrapper() = default;
+
+        template <typename Elem, typename Traits>
+        void output(std::basic_ostream<Elem, Traits>& os) const
+        {
+            const detail::latency_scope<Policy> timer{ operation::bulk_format };
+            INTEGRAL_IO_PROBE1(batch_begin, m_rows);
+            output(os, std::index_sequence_for<Integers...>{});
+            INTEGRAL_IO_PROBE2(batch_end, m_rows, m_rows);
+        }
+
+        const std::size_t m_rows;
+        const std::tuple<const Integers*...> m_columns;
+
+    private:
+        template <typename Elem, typename Traits, std::size_t... Columns>
+        void output(std::basic_ostream<Elem, Traits>& os, std::index_sequence<Columns...>) const
+        {
+            constexpr std::size_t column_count = sizeof...(Integers);
+            const std::size_t widths[column_count] = { detail::column_width(std::get<Columns>(m_columns), m_rows)... };
+            std::size_t row_width = (column_count - 1) * Policy::column_separator.size() + 1;
+            for (const std::size_t width : widths)
+                row_width += width;
+
+            constexpr std::size_t block_size = 16384;
+            const std::size_t rows_per_block = row_width < block_size ? block_size / row_width : 1;
+            std::vector<char> buffer((m_rows < rows_per_block ? m_rows : rows_per_block) * row_width);
+            for (std::size_t row = 0; row < m_rows && os;)
             {
-                // A negative number is allowed to wrap around to positive, as long as its magnitude is
-                //  less than the maximum representable value.
-                if ((temp * -1) <= static_cast<std::int16_t>(std::numeric_limits<Integer>::max()))
+                const std::size_t block_end = m_rows - row < rows_per_block ? m_rows : row + rows_per_block;
+                char* out = buffer.data();
+                for (; row < block_end; ++row)
                 {
-                    m_value = static_cast<Integer>(std::numeric_limits<Integer>::max() + temp + 1);
-                    return;
+                    ((out = detail::format_cell<Policy>(out, widths[Columns], std::get<Columns>(m_columns)[row]),
+                        Columns + 1 < column_count ? (out = std::copy(Policy::column_separator.begin(), Policy::column_separator.end(), out)) : out), ...);
+                    *out++ = '\n';
                 }
-
-                // Any negative numbers with a larger magnitude are out of bounds.
-                m_value = std::numeric_limits<Integer>::max();
-                is.setstate(std::ios_base::failbit);
-                return;
+                detail::write_formatted(os, std::string_view(buffer.data(), static_cast<std::size_t>(out - buffer.data())));
             }
+        }
+    };
+
+    // Output-only wrapper for an integer count of units of 10^-Scale, written as a fixed-point
+    //  decimal, e.g. 12345 with a scale of 2 is written as 123.45.
+    template <typename Integer, unsigned Scale, typename Policy = default_policy>
+    struct integral_fixed_output_wrapper final
+    {
+        static_assert(std::is_integral<Integer>::value, "as_fixed() requires an integer type");
+        static_assert(Scale <= static_cast<unsigned>(std::numeric_limits<Integer>::digits10), "the scale leaves no room for an integer part");
+
+        integral_fixed_output_wrapper(const Integer value) : m_value{ value } {}
+        integral_fixed_output_wrapper(integral_fixed_output_wrapper&) = default;
+        integral_fixed_output_wrapper(integral_fixed_output_wrapper&&) = default;
+        integral_fixed_output_wrapper& operator=(const integral_fixed_output_wrapper&) = delete;
+        integral_fixed_output_wrapper& operator=(integral_fixed_output_wrapper&&) = delete;
+        ~integral_fixed_output_wrapper() = default;
+
+        template <typename Elem, typename Traits>
+        void output(std::basic_ostream<Elem, Traits>& os) const
+        {
+            const detail::latency_scope<Policy> timer{ operation::format };
+            detail::write_fixed<Scale>(os, m_value);
+        }
+
+        const Integer m_value;
+    };
+
+    // Input/output wrapper for an integer count of units of 10^-Scale. Input accepts e.g. 123.45,
+    //  123.4 or 123 (all scaled exactly), and rounds any further fraction digits according to the
+    //  policy's fixed_rounding. The policy's grammar, length limits and overflow mode apply to the
+    //  scaled value as they do for as_integer().
+    template <typename Integer, unsigned Scale, typename Policy = default_policy>
+    struct integral_fixed_io_wrapper
+    {
+        static_assert(std::is_integral<Integer>::value, "as_fixed() requires an integer type");
+        static_assert(Scale <= static_cast<unsigned>(std::numeric_limits<Integer>::digits10), "the scale leaves no room for an integer part");
+
+        integral_fixed_io_wrapper(Integer& value) : m_value{ value } {}
+        integral_fixed_io_wrapper(integral_fixed_io_wrapper&) = default;
+        integral_fixed_io_wrapper(integral_fixed_io_wrapper&&) = default;
+        integral_fixed_io_wrapper& operator=(const integral_fixed_io_wrapper&) = delete;
+        integral_fixed_io_wrapper& operator=(integral_fixed_io_wrapper&&) = delete;
+        ~integral_fixed_io_wrapper() = default;
+
+        template <typename Elem, typename Traits>
+        void output(std::basic_ostream<Elem, Traits>& os) const
+        {
+            const detail::latency_scope<Policy> timer{ operation::format };
+            detail::write_fixed<Scale>(os, m_value);
+        }
 
-            m_value = static_cast<Integer>(temp);
+        template <typename Elem, typename Traits>
+        void input(std::basic_istream<Elem, Traits>& is)
+        {
+            const detail::latency_scope<Policy> timer{ operation::parse };
+            detail::read_fixed<Policy, Scale>(is, m_value);
         }
 
         Integer& m_value;
     };
 
     // Stream operators:
-    template <typename Elem, typename Traits, typename Integer>
-    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_output_wrapper<Integer>&& wrapper)
+    template <typename Elem, typename Traits, typename Integer, typename Policy>
+    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_output_wrapper<Integer, Policy>&& wrapper)
+    {
+        wrapper.output(os);
+        return os;
+    }
+
+    template <typename Elem, typename Traits, typename Integer, typename Policy>
+    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_io_wrapper<Integer, Policy>&& wrapper)
+    {
+        wrapper.output(os);
+        return os;
+    }
+
+    template <typename Elem, typename Traits, typename Integer, typename Policy>
+    std::basic_istream<Elem, Traits>& operator>>(std::basic_istream<Elem, Traits>& is, integral_io_wrapper<Integer, Policy>&& wrapper)
+    {
+        wrapper.input(is);
+        return is;
+    }
+
+    template <typename Elem, typename Traits, typename Integer, typename Policy>
+    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_span_output_wrapper<Integer, Policy>&& wrapper)
+    {
+        wrapper.output(os);
+        return os;
+    }
+
+    template <typename Elem, typename Traits, typename Integer, typename Policy>
+    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_span_io_wrapper<Integer, Policy>&& wrapper)
+    {
+        wrapper.output(os);
+        return os;
+    }
+
+    template <typename Elem, typename Traits, typename Composite, typename Policy>
+    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_composite_output_wrapper<Composite, Policy>&& wrapper)
     {
         wrapper.output(os);
         return os;
     }
 
-    template <typename Elem, typename Traits, typename Integer>
-    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_io_wrapper<Integer>&& wrapper)
+    template <typename Elem, typename Traits, typename Policy, typename... Integers>
+    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_table_output_wrapper<Policy, Integers...>&& wrapper)
     {
         wrapper.output(os);
         return os;
     }
 
-    template <typename Elem, typename Traits, typename Integer>
-    std::basic_istream<Elem, Traits>& operator>>(std::basic_istream<Elem, Traits>& is, integral_io_wrapper<Integer>&& wrapper)
+    template <typename Elem, typename Traits, typename Integer, unsigned Scale, typename Policy>
+    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_fixed_output_wrapper<Integer, Scale, Policy>&& wrapper)
+    {
+        wrapper.output(os);
+        return os;
+    }
+
+    template <typename Elem, typename Traits, typename Integer, unsigned Scale, typename Policy>
+    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_fixed_io_wrapper<Integer, Scale, Policy>&& wrapper)
+    {
+        wrapper.output(os);
+        return os;
+    }
+
+    template <typename Elem, typename Traits, typename Integer, unsigned Scale, typename Policy>
+    std::basic_istream<Elem, Traits>& operator>>(std::basic_istream<Elem, Traits>& is, integral_fixed_io_wrapper<Integer, Scale, Policy>&& wrapper)
+    {
+        wrapper.input(is);
+        return is;
+    }
+
+    // Unlike the other operators, this also accepts an lvalue so the caller can check m_read.
+    template <typename Elem, typename Traits, typename Integer, typename Policy>
+    std::basic_istream<Elem, Traits>& operator>>(std::basic_istream<Elem, Traits>& is, integral_span_io_wrapper<Integer, Policy>& wrapper)
+    {
+        wrapper.input(is);
+        return is;
+    }
+
+    template <typename Elem, typename Traits, typename Integer, typename Policy>
+    std::basic_istream<Elem, Traits>& operator>>(std::basic_istream<Elem, Traits>& is, integral_span_io_wrapper<Integer, Policy>&& wrapper)
     {
         wrapper.input(is);
         return is;
@@ -221,15 +4451,222 @@ namespace integral_io
 
 
     // Main public interface:
-    template <typename Integer>
-    integral_output_wrapper<Integer> as_integer(const Integer& value)
+    // The policy is optional, e.g. as_integer(value) or as_integer<latency_policy>(value).
+    template <typename Policy = default_policy, typename Integer>
+    integral_output_wrapper<Integer, Policy> as_integer(const Integer& value)
     {
-        return integral_output_wrapper<Integer>(value);
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_integer() requires a policy derived from default_policy");
+        return integral_output_wrapper<Integer, Policy>(value);
     }
 
-    template <typename Integer>
-    integral_io_wrapper<Integer> as_integer(Integer& value)
+    template <typename Policy = default_policy, typename Integer>
+    integral_io_wrapper<Integer, Policy> as_integer(Integer& value)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_integer() requires a policy derived from default_policy");
+        return integral_io_wrapper<Integer, Policy>(value);
+    }
+
+    // Containers and aggregates of integers are output-only.
+    template <typename Policy = default_policy, typename Composite, typename = typename std::enable_if<detail::is_composite<Composite>::value>::type>
+    integral_composite_output_wrapper<Composite, Policy> as_integer(const Composite& value)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_integer() requires a policy derived from default_policy");
+        return integral_composite_output_wrapper<Composite, Policy>(value);
+    }
+
+    // Bulk interface, for a pointer and count or a contiguous container (e.g. std::vector):
+    template <typename Policy = default_policy, typename Integer>
+    integral_span_output_wrapper<Integer, Policy> as_integers(const Integer* values, const std::size_t count)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_integers() requires a policy derived from default_policy");
+        return integral_span_output_wrapper<Integer, Policy>(values, count);
+    }
+
+    template <typename Policy = default_policy, typename Integer>
+    integral_span_io_wrapper<Integer, Policy> as_integers(Integer* values, const std::size_t count)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_integers() requires a policy derived from default_policy");
+        return integral_span_io_wrapper<Integer, Policy>(values, count);
+    }
+
+    template <typename Policy = default_policy, typename Container>
+    auto as_integers(Container& values) -> decltype(as_integers<Policy>(values.data(), values.size()))
+    {
+        return as_integers<Policy>(values.data(), values.size());
+    }
+
+    // Table interface, for a row count and a pointer to each column, or contiguous containers (in
+    //  which case the shortest one sets the number of rows):
+    template <typename Policy = default_policy, typename... Integers>
+    integral_table_output_wrapper<Policy, Integers...> as_table(const std::size_t rows, const Integers*... columns)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_table() requires a policy derived from default_policy");
+        return integral_table_output_wrapper<Policy, Integers...>(rows, columns...);
+    }
+
+    template <typename Policy = default_policy, typename... Containers>
+    auto as_table(const Containers&... columns) -> integral_table_output_wrapper<Policy, typename std::remove_cv<typename std::remove_pointer<decltype(columns.data())>::type>::type...>
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_table() requires a policy derived from default_policy");
+        return integral_table_output_wrapper<Policy, typename std::remove_cv<typename std::remove_pointer<decltype(columns.data())>::type>::type...>(
+            std::min({ static_cast<std::size_t>(columns.size())... }), columns.data()...);
+    }
+
+    // Fixed-point interface, for an integer count of units of 10^-Scale, e.g. as_fixed<2>(cents) or
+    //  as_fixed<3, saturate>(millimetres):
+    template <unsigned Scale, typename Policy = default_policy, typename Integer>
+    integral_fixed_output_wrapper<Integer, Scale, Policy> as_fixed(const Integer& value)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_fixed() requires a policy derived from default_policy");
+        return integral_fixed_output_wrapper<Integer, Scale, Policy>(value);
+    }
+
+    template <unsigned Scale, typename Policy = default_policy, typename Integer>
+    integral_fixed_io_wrapper<Integer, Scale, Policy> as_fixed(Integer& value)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_fixed() requires a policy derived from default_policy");
+        return integral_fixed_io_wrapper<Integer, Scale, Policy>(value);
+    }
+
+    // Output to memory:
+    // The text is the same as as_integers() writes to a stream with default formatting.
+
+    // The exact number of characters needed to write a sequence of integers, with delimiters.
+    template <typename Policy = default_policy, typename Integer>
+    std::size_t formatted_size(const Integer* const values, const std::size_t count)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "formatted_size() requires a policy derived from default_policy");
+        return count == 0 ? 0 : detail::count_characters<Policy>(values, count) + (count - 1);
+    }
+
+    template <typename Policy = default_policy, typename Container>
+    auto formatted_size(const Container& values) -> decltype(formatted_size<Policy>(values.data(), values.size()))
+    {
+        return formatted_size<Policy>(values.data(), values.size());
+    }
+
+    // Writes a sequence of integers to memory, with no bounds checks. Exactly formatted_size()
+    //  characters are written, and a pointer to the end is returned.
+    template <typename Policy = default_policy, typename Integer>
+    char* format_to(char* const out, const Integer* const values, const std::size_t count)
     {
-        return integral_io_wrapper<Integer>(value);
+        static_assert(std::is_base_of<default_policy, Policy>::value, "format_to() requires a policy derived from default_policy");
+        if (count == 0)
+            return out;
+        char* const last = detail::format_values<Policy, true>(out, values, count - 1);
+        return detail::format_value<Policy, true>(last, values[count - 1]);
+    }
+
+    // Formats a sequence of integers into a string, which is allocated once at its exact size.
+    template <typename Policy = default_policy, typename Integer>
+    std::string to_string(const Integer* const values, const std::size_t count)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "to_string() requires a policy derived from default_policy");
+        const std::size_t size = formatted_size<Policy>(values, count);
+        if (size == 0)
+            return std::string();
+        // Room for the delimiter after the last value, and for the fixed-size copies beyond it.
+        std::string text(size + 1 + detail::format_slack, '\0');
+        detail::format_values<Policy, false>(&text[0], values, count);
+        text.resize(size);
+        return text;
+    }
+
+    template <typename Policy = default_policy, typename Container>
+    auto to_string(const Container& values) -> decltype(to_string<Policy>(values.data(), values.size()))
+    {
+        return to_string<Policy>(values.data(), values.size());
     }
 }
+
+// std::format support, e.g. std::format("{:>4}", as_integer(value)). 1-byte integers are formatted as
+//  numbers, and the usual fill, alignment, sign, #, 0, width and b/B/o/d/x/X specs are supported.
+//  Without a type, the wrapper's policy decides the radix and notation.
+#if defined(__cpp_lib_format)
+template <typename Integer, typename Policy, typename Enable, std::size_t Size, typename CharT>
+struct std::formatter<integral_io::integral_output_wrapper<Integer, Policy, Enable, Size>, CharT>
+{
+    template <typename ParseContext>
+    constexpr typename ParseContext::iterator parse(ParseContext& ctx)
+    {
+        auto it = ctx.begin();
+        if (const char* const error = m_formatter.parse(it, ctx.end()))
+            throw std::format_error(error);
+        return it;
+    }
+
+    template <typename FormatContext>
+    typename FormatContext::iterator format(const integral_io::integral_output_wrapper<Integer, Policy, Enable, Size>& wrapper, FormatContext& ctx) const
+    {
+        return m_formatter.template format<Policy>(ctx.out(), wrapper.m_value);
+    }
+
+    integral_io::detail::wrapper_formatter<CharT> m_formatter;
+};
+
+template <typename Integer, typename Policy, typename Enable, std::size_t Size, bool Signed, typename CharT>
+struct std::formatter<integral_io::integral_io_wrapper<Integer, Policy, Enable, Size, Signed>, CharT>
+{
+    template <typename ParseContext>
+    constexpr typename ParseContext::iterator parse(ParseContext& ctx)
+    {
+        auto it = ctx.begin();
+        if (const char* const error = m_formatter.parse(it, ctx.end()))
+            throw std::format_error(error);
+        return it;
+    }
+
+    template <typename FormatContext>
+    typename FormatContext::iterator format(const integral_io::integral_io_wrapper<Integer, Policy, Enable, Size, Signed>& wrapper, FormatContext& ctx) const
+    {
+        return m_formatter.template format<Policy>(ctx.out(), wrapper.m_value);
+    }
+
+    integral_io::detail::wrapper_formatter<CharT> m_formatter;
+};
+#endif
+
+// {fmt} support, with the same specs as std::format. {fmt} must be included before this header.
+#if defined(FMT_VERSION)
+template <typename Integer, typename Policy, typename Enable, std::size_t Size, typename CharT>
+struct fmt::formatter<integral_io::integral_output_wrapper<Integer, Policy, Enable, Size>, CharT>
+{
+    template <typename ParseContext>
+    constexpr typename ParseContext::iterator parse(ParseContext& ctx)
+    {
+        auto it = ctx.begin();
+        if (const char* const error = m_formatter.parse(it, ctx.end()))
+            throw fmt::format_error(error);
+        return it;
+    }
+
+    template <typename FormatContext>
+    typename FormatContext::iterator format(const integral_io::integral_output_wrapper<Integer, Policy, Enable, Size>& wrapper, FormatContext& ctx) const
+    {
+        return m_formatter.template format<Policy>(ctx.out(), wrapper.m_value);
+    }
+
+    integral_io::detail::wrapper_formatter<CharT> m_formatter;
+};
+
+template <typename Integer, typename Policy, typename Enable, std::size_t Size, bool Signed, typename CharT>
+struct fmt::formatter<integral_io::integral_io_wrapper<Integer, Policy, Enable, Size, Signed>, CharT>
+{
+    template <typename ParseContext>
+    constexpr typename ParseContext::iterator parse(ParseContext& ctx)
+    {
+        auto it = ctx.begin();
+        if (const char* const error = m_formatter.parse(it, ctx.end()))
+            throw fmt::format_error(error);
+        return it;
+    }
+
+    template <typename FormatContext>
+    typename FormatContext::iterator format(const integral_io::integral_io_wrapper<Integer, Policy, Enable, Size, Signed>& wrapper, FormatContext& ctx) const
+    {
+        return m_formatter.template format<Policy>(ctx.out(), wrapper.m_value);
+    }
+
+    integral_io::detail::wrapper_formatter<CharT> m_formatter;
+};
+#endif
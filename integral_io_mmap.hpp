@@ -0,0 +1,486 @@
+#pragma once
+
+#include "integral_io.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#   if !defined(NOMINMAX)
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+// Read-only memory-mapped files, and typed views of the integers in them in either byte order.
+
+namespace integral_io
+{
+    // The byte order of integers in memory or in a file.
+    enum class endian
+    {
+        little,
+        big,
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        native = big,
+#else
+        native = little,
+#endif
+    };
+
+    // A whole file mapped read-only into memory. An empty file maps to no data.
+    class mapped_file
+    {
+    public:
+        mapped_file() = default;
+        explicit mapped_file(const std::string& path) { open(path); }
+        mapped_file(const mapped_file&) = delete;
+        mapped_file(mapped_file&& other) noexcept { swap(other); }
+        mapped_file& operator=(const mapped_file&) = delete;
+        mapped_file& operator=(mapped_file&& other) noexcept
+        {
+            mapped_file moved{ std::move(other) };
+            swap(moved);
+            return *this;
+        }
+        ~mapped_file() { close(); }
+
+        // Maps a file, after unmapping any file already mapped. Returns false, and sets error(), if
+        //  the file can't be opened or mapped. Only regular files can be mapped; anything else (e.g. a
+        //  pipe) fails with std::errc::no_such_device.
+        bool open(const std::string& path)
+        {
+            close();
+#if defined(_WIN32)
+            const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                return fail(static_cast<int>(GetLastError()));
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size))
+            {
+                const DWORD error = GetLastError();
+                CloseHandle(file);
+                return fail(static_cast<int>(error));
+            }
+            if (GetFileType(file) != FILE_TYPE_DISK)
+            {
+                CloseHandle(file);
+                m_error = std::make_error_code(std::errc::no_such_device);
+                return false;
+            }
+            if (size.QuadPart != 0)
+            {
+                const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                const void* const data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+                const DWORD error = GetLastError();
+                if (mapping)
+                    CloseHandle(mapping);
+                CloseHandle(file);
+                if (!data)
+                    return fail(static_cast<int>(error));
+                m_data = static_cast<const unsigned char*>(data);
+            }
+            else
+            {
+                CloseHandle(file);
+            }
+            m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+            const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (file < 0)
+                return fail(errno);
+            struct stat status;
+            if (fstat(file, &status) != 0)
+            {
+                const int error = errno;
+                ::close(file);
+                return fail(error);
+            }
+            if (!S_ISREG(status.st_mode))
+            {
+                ::close(file);
+                m_error = std::make_error_code(std::errc::no_such_device);
+                return false;
+            }
+            if (status.st_size != 0)
+            {
+                void* const data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+                const int error = errno;
+                ::close(file);
+                if (data == MAP_FAILED)
+                    return fail(error);
+                m_data = static_cast<const unsigned char*>(data);
+            }
+            else
+            {
+                ::close(file);
+            }
+            m_size = static_cast<std::size_t>(status.st_size);
+#endif
+            m_open = true;
+            m_error.clear();
+            return true;
+        }
+
+        void close() noexcept
+        {
+            if (m_data)
+            {
+#if defined(_WIN32)
+                UnmapViewOfFile(m_data);
+#else
+                munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+            }
+            m_data = nullptr;
+            m_size = 0;
+            m_open = false;
+        }
+
+        bool is_open() const noexcept { return m_open; }
+        explicit operator bool() const noexcept { return m_open; }
+        const unsigned char* data() const noexcept { return m_data; }
+        std::size_t size() const noexcept { return m_size; }
+
+        // Why the last open() failed.
+        std::error_code error() const noexcept { return m_error; }
+
+        void swap(mapped_file& other) noexcept
+        {
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+            std::swap(m_open, other.m_open);
+            std::swap(m_error, other.m_error);
+        }
+
+    private:
+        bool fail(const int error)
+        {
+            m_error = std::error_code(error, std::system_category());
+            return false;
+        }
+
+        const unsigned char* m_data = nullptr;
+        std::size_t m_size = 0;
+        bool m_open = false;
+        std::error_code m_error;
+    };
+
+    namespace detail
+    {
+        // Loads an integer from memory which may not be aligned, swapping its bytes if asked.
+        template <typename Integer>
+        Integer load_integer(const unsigned char* const bytes, const bool swap) noexcept
+        {
+            Integer value;
+            std::memcpy(&value, bytes, sizeof(value));
+            return swap ? byte_swap(value) : value;
+        }
+
+        // Copies count integers to out in the native byte order, with the vectorised byte swap when
+        //  they aren't already in it. When swapping, out may be the input itself.
+        template <typename Integer>
+        void copy_integers(const unsigned char* const bytes, const std::size_t count, const bool swap, Integer* const out)
+        {
+            if (count == 0)
+                return;
+            if (!swap || sizeof(Integer) == 1)
+            {
+                std::memcpy(out, bytes, count * sizeof(Integer));
+                return;
+            }
+            initialise_kernels();
+            byte_swap_kernel.load(std::memory_order_relaxed)(bytes, out, count, sizeof(Integer));
+        }
+
+        // A random-access iterator over integers stored in either byte order. Swap is bool when the
+        //  order is only known at run time, or std::true_type/std::false_type when it's fixed.
+        template <typename Integer, typename Swap>
+        class endian_iterator
+        {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = Integer;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = Integer;
+
+            endian_iterator() = default;
+            endian_iterator(const unsigned char* bytes, const Swap swap) : m_bytes{ bytes }, m_swap{ swap } {}
+
+            Integer operator*() const { return load_integer<Integer>(m_bytes, static_cast<bool>(m_swap)); }
+            Integer operator[](const difference_type n) const { return *(*this + n); }
+
+            endian_iterator& operator++() { m_bytes += sizeof(Integer); return *this; }
+            endian_iterator operator++(int) { endian_iterator old = *this; ++*this; return old; }
+            endian_iterator& operator--() { m_bytes -= sizeof(Integer); return *this; }
+            endian_iterator operator--(int) { endian_iterator old = *this; --*this; return old; }
+            endian_iterator& operator+=(const difference_type n) { m_bytes += n * static_cast<difference_type>(sizeof(Integer)); return *this; }
+            endian_iterator& operator-=(const difference_type n) { m_bytes -= n * static_cast<difference_type>(sizeof(Integer)); return *this; }
+            friend endian_iterator operator+(endian_iterator it, const difference_type n) { return it += n; }
+            friend endian_iterator operator+(const difference_type n, endian_iterator it) { return it += n; }
+            friend endian_iterator operator-(endian_iterator it, const difference_type n) { return it -= n; }
+            friend difference_type operator-(const endian_iterator& a, const endian_iterator& b) { return (a.m_bytes - b.m_bytes) / static_cast<difference_type>(sizeof(Integer)); }
+
+            friend bool operator==(const endian_iterator& a, const endian_iterator& b) { return a.m_bytes == b.m_bytes; }
+            friend bool operator!=(const endian_iterator& a, const endian_iterator& b) { return a.m_bytes != b.m_bytes; }
+            friend bool operator<(const endian_iterator& a, const endian_iterator& b) { return a.m_bytes < b.m_bytes; }
+            friend bool operator>(const endian_iterator& a, const endian_iterator& b) { return a.m_bytes > b.m_bytes; }
+            friend bool operator<=(const endian_iterator& a, const endian_iterator& b) { return a.m_bytes <= b.m_bytes; }
+            friend bool operator>=(const endian_iterator& a, const endian_iterator& b) { return a.m_bytes >= b.m_bytes; }
+
+        private:
+            const unsigned char* m_bytes = nullptr;
+            Swap m_swap{};
+        };
+    }
+
+    // A read-only view of integers stored in memory in either byte order, e.g. in a mapped file. The
+    //  values needn't be aligned. Each one is loaded (and its bytes swapped, if they aren't in the
+    //  native order) as it's read, so nothing is converted up front.
+    template <typename Integer>
+    class endian_span
+    {
+        static_assert(std::is_integral<Integer>::value, "endian_span requires an integer type");
+
+    public:
+        using iterator = detail::endian_iterator<Integer, bool>;
+        using value_type = Integer;
+        using size_type = std::size_t;
+        using const_iterator = iterator;
+
+        endian_span() = default;
+        endian_span(const void* const bytes, const std::size_t count, const endian order) :
+            m_bytes{ static_cast<const unsigned char*>(bytes) }, m_count{ count }, m_swap{ sizeof(Integer) != 1 && order != endian::native } {}
+
+        std::size_t size() const { return m_count; }
+        bool empty() const { return m_count == 0; }
+
+        Integer operator[](const std::size_t i) const { return detail::load_integer<Integer>(m_bytes + i * sizeof(Integer), m_swap); }
+        Integer front() const { return (*this)[0]; }
+        Integer back() const { return (*this)[m_count - 1]; }
+
+        iterator begin() const { return iterator{ m_bytes, m_swap }; }
+        iterator end() const { return iterator{ m_bytes + m_count * sizeof(Integer), m_swap }; }
+
+        // True if the values are already in the native byte order.
+        bool is_native() const { return !m_swap; }
+
+        // The values themselves, without copying, if they're in the native byte order and aligned;
+        //  otherwise nullptr.
+        const Integer* data() const
+        {
+            if (m_swap || reinterpret_cast<std::uintptr_t>(m_bytes) % alignof(Integer) != 0)
+                return nullptr;
+            return reinterpret_cast<const Integer*>(m_bytes);
+        }
+
+        // Copies count values, starting at first, to out in the native byte order.
+        void copy_to(const std::size_t first, const std::size_t count, Integer* const out) const
+        {
+            detail::copy_integers(m_bytes + first * sizeof(Integer), count, m_swap, out);
+        }
+
+        void copy_to(Integer* const out) const { copy_to(0, m_count, out); }
+
+    private:
+        const unsigned char* m_bytes = nullptr;
+        std::size_t m_count = 0;
+        bool m_swap = false;
+    };
+
+    // A binary file of integers in a fixed byte order, mapped read-only and viewed as an array. The
+    //  order is part of the type, so reading a value costs a load, plus a byte swap only when Order
+    //  isn't the native order.
+    template <typename Integer, endian Order = endian::native>
+    class mapped_array
+    {
+        static_assert(std::is_integral<Integer>::value, "mapped_array requires an integer type");
+
+        using swap_type = std::integral_constant<bool, sizeof(Integer) != 1 && Order != endian::native>;
+
+    public:
+        using iterator = detail::endian_iterator<Integer, swap_type>;
+        using value_type = Integer;
+        using size_type = std::size_t;
+        using const_iterator = iterator;
+
+        mapped_array() = default;
+        explicit mapped_array(const std::string& path, const std::size_t offset = 0) { open(path, offset); }
+        mapped_array(const mapped_array&) = delete;
+        mapped_array(mapped_array&& other) noexcept { swap(other); }
+        mapped_array& operator=(const mapped_array&) = delete;
+        mapped_array& operator=(mapped_array&& other) noexcept
+        {
+            mapped_array moved{ std::move(other) };
+            swap(moved);
+            return *this;
+        }
+
+        // Maps a file and views the values from offset bytes onwards, e.g. after a header. Returns
+        //  false, and sets error(), if the file can't be mapped, or with std::errc::invalid_argument
+        //  if the bytes after offset aren't a whole number of values.
+        bool open(const std::string& path, const std::size_t offset = 0)
+        {
+            close();
+            if (!m_file.open(path))
+            {
+                m_error = m_file.error();
+                return false;
+            }
+            if (offset > m_file.size() || (m_file.size() - offset) % sizeof(Integer) != 0)
+            {
+                m_file.close();
+                m_error = std::make_error_code(std::errc::invalid_argument);
+                return false;
+            }
+            m_bytes = m_file.data() + offset;
+            m_count = (m_file.size() - offset) / sizeof(Integer);
+            m_error.clear();
+            return true;
+        }
+
+        void close() noexcept
+        {
+            m_file.close();
+            m_bytes = nullptr;
+            m_count = 0;
+        }
+
+        bool is_open() const noexcept { return m_file.is_open(); }
+        explicit operator bool() const noexcept { return m_file.is_open(); }
+
+        // Why the last open() failed.
+        std::error_code error() const noexcept { return m_error; }
+
+        std::size_t size() const { return m_count; }
+        bool empty() const { return m_count == 0; }
+
+        Integer operator[](const std::size_t i) const { return detail::load_integer<Integer>(m_bytes + i * sizeof(Integer), swap_type::value); }
+        Integer front() const { return (*this)[0]; }
+        Integer back() const { return (*this)[m_count - 1]; }
+
+        iterator begin() const { return iterator{ m_bytes, swap_type{} }; }
+        iterator end() const { return iterator{ m_bytes + m_count * sizeof(Integer), swap_type{} }; }
+
+        // The values themselves, without copying, if they're in the native byte order and aligned;
+        //  otherwise nullptr.
+        const Integer* data() const { return span().data(); }
+
+        endian_span<Integer> span() const { return endian_span<Integer>(m_bytes, m_count, Order); }
+
+        // Copies count values, starting at first, to out in the native byte order.
+        void copy_to(const std::size_t first, const std::size_t count, Integer* const out) const
+        {
+            detail::copy_integers(m_bytes + first * sizeof(Integer), count, swap_type::value, out);
+        }
+
+        void copy_to(Integer* const out) const { copy_to(0, m_count, out); }
+
+        void swap(mapped_array& other) noexcept
+        {
+            m_file.swap(other.m_file);
+            std::swap(m_bytes, other.m_bytes);
+            std::swap(m_count, other.m_count);
+            std::swap(m_error, other.m_error);
+        }
+
+    private:
+        mapped_file m_file;
+        const unsigned char* m_bytes = nullptr;
+        std::size_t m_count = 0;
+        std::error_code m_error;
+    };
+
+    // Output wrapper for integers in either byte order, separated by the policy's delimiter. Values
+    //  in the native order are formatted where they are; otherwise a few thousand at a time are
+    //  copied out, swapping their bytes, and formatted from the copy.
+    template <typename Integer, typename Policy = default_policy>
+    struct integral_endian_output_wrapper final
+    {
+        explicit integral_endian_output_wrapper(const endian_span<Integer> values) : m_values{ values } {}
+        integral_endian_output_wrapper(integral_endian_output_wrapper&) = default;
+        integral_endian_output_wrapper(integral_endian_output_wrapper&&) = default;
+        integral_endian_output_wrapper& operator=(const integral_endian_output_wrapper&) = delete;
+        integral_endian_output_wrapper& operator=(integral_endian_output_wrapper&&) = delete;
+        ~integral_endian_output_wrapper() = default;
+
+        template <typename Elem, typename Traits>
+        void output(std::basic_ostream<Elem, Traits>& os) const
+        {
+            const detail::latency_scope<Policy> timer{ operation::bulk_format };
+            const std::size_t count = m_values.size();
+            INTEGRAL_IO_PROBE1(batch_begin, count);
+            if (const Integer* const values = m_values.data())
+            {
+                detail::write_integers<Policy>(os, values, count);
+            }
+            else
+            {
+                constexpr std::size_t chunk = 4096;
+                std::vector<Integer> buffer(std::min(chunk, count));
+                for (std::size_t i = 0; i < count && os; i += chunk)
+                {
+                    const std::size_t n = std::min(chunk, count - i);
+                    m_values.copy_to(i, n, buffer.data());
+                    if (i != 0)
+                        os.put(os.widen(Policy::delimiter));
+                    detail::write_integers<Policy>(os, buffer.data(), n);
+                }
+            }
+            INTEGRAL_IO_PROBE2(batch_end, count, count);
+        }
+
+        const endian_span<Integer> m_values;
+    };
+
+    template <typename Elem, typename Traits, typename Integer, typename Policy>
+    std::basic_ostream<Elem, Traits>& operator<<(std::basic_ostream<Elem, Traits>& os, const integral_endian_output_wrapper<Integer, Policy>&& wrapper)
+    {
+        wrapper.output(os);
+        return os;
+    }
+
+    // Bulk output of integers in either byte order. These are more specialised than the overload for
+    //  contiguous containers, whose data() may be nullptr here.
+    template <typename Policy = default_policy, typename Integer>
+    integral_endian_output_wrapper<Integer, Policy> as_integers(const endian_span<Integer>& values)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_integers() requires a policy derived from default_policy");
+        return integral_endian_output_wrapper<Integer, Policy>(values);
+    }
+
+    template <typename Policy = default_policy, typename Integer>
+    integral_endian_output_wrapper<Integer, Policy> as_integers(endian_span<Integer>& values)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_integers() requires a policy derived from default_policy");
+        return integral_endian_output_wrapper<Integer, Policy>(values);
+    }
+
+    template <typename Policy = default_policy, typename Integer, endian Order>
+    integral_endian_output_wrapper<Integer, Policy> as_integers(const mapped_array<Integer, Order>& values)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_integers() requires a policy derived from default_policy");
+        return integral_endian_output_wrapper<Integer, Policy>(values.span());
+    }
+
+    template <typename Policy = default_policy, typename Integer, endian Order>
+    integral_endian_output_wrapper<Integer, Policy> as_integers(mapped_array<Integer, Order>& values)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "as_integers() requires a policy derived from default_policy");
+        return integral_endian_output_wrapper<Integer, Policy>(values.span());
+    }
+}
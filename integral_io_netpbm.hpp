@@ -0,0 +1,414 @@
+#pragma once
+
+#include "integral_io.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Reading and writing Netpbm grayscale and colour images: plain (text) PGM and PPM, which are P2 and
+//  P3, and raw (binary) PGM and PPM, which are P5 and P6. A file starts with a header, e.g.
+//
+//      P2
+//      # A comment.
+//      4 2
+//      255
+//      0 64 128 255
+//      255 128 64 0
+//
+// which gives the width, the height, and the largest sample value (up to 65535). Samples are 1-byte
+//  if the maximum fits in a byte and 2-byte otherwise. In the plain formats they are whitespace-
+//  separated decimal numbers; in the raw formats they are binary and big-endian. PPM has 3 samples
+//  (red, green and blue) per pixel, and PGM has 1.
+
+namespace integral_io
+{
+    enum class netpbm_format
+    {
+        plain_pgm = 2,
+        plain_ppm = 3,
+        raw_pgm = 5,
+        raw_ppm = 6,
+    };
+
+    struct netpbm_header
+    {
+        netpbm_format format = netpbm_format::plain_pgm;
+        std::size_t width = 0;
+        std::size_t height = 0;
+        unsigned maxval = 255;
+
+        bool is_plain() const { return format == netpbm_format::plain_pgm || format == netpbm_format::plain_ppm; }
+        std::size_t channels() const { return format == netpbm_format::plain_ppm || format == netpbm_format::raw_ppm ? 3 : 1; }
+
+        // The number of samples in each row.
+        std::size_t row_size() const { return width * channels(); }
+    };
+
+    // An image in memory. The samples are in row-major order, with the channels of each pixel
+    //  together. Sample is std::uint8_t, which only holds images with a maxval up to 255, or
+    //  std::uint16_t.
+    template <typename Sample>
+    struct netpbm_image
+    {
+        static_assert(std::is_same<Sample, std::uint8_t>::value || std::is_same<Sample, std::uint16_t>::value, "Netpbm samples are std::uint8_t or std::uint16_t");
+
+        netpbm_header header;
+        std::vector<Sample> samples;
+    };
+
+    namespace detail
+    {
+        // Samples are parsed in the stream grammar, since the plain formats allow any whitespace
+        //  between them, and values which don't fit the sample type fail.
+        struct netpbm_policy : default_policy
+        {
+            static constexpr overflow_mode overflow = overflow_mode::fail_only;
+            static constexpr std::size_t max_token_length = 16;
+            static constexpr output_table table = output_table::bytes_and_shorts;
+        };
+
+        // The spec limits lines of plain samples to 70 characters.
+        constexpr std::size_t netpbm_line_length = 70;
+
+        // Returns the number of samples in an image, or 0 if it would overflow.
+        inline std::size_t netpbm_sample_count(const netpbm_header& header)
+        {
+            const std::size_t row_size = header.row_size();
+            if (header.width != 0 && row_size / header.width != header.channels())
+                return 0;
+            if (header.height != 0 && row_size > std::numeric_limits<std::size_t>::max() / header.height)
+                return 0;
+            return row_size * header.height;
+        }
+
+        inline bool is_netpbm_space(const int c)
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+        }
+
+        // Reads a header number, after at least one whitespace character or comment.
+        template <typename Integer>
+        bool read_netpbm_number(std::streambuf& buffer, Integer& value)
+        {
+            using traits = std::streambuf::traits_type;
+            bool separated = false;
+            for (int c = buffer.sgetc();; c = buffer.sgetc())
+            {
+                if (c == '#')
+                {
+                    while (c != traits::eof() && c != '\n' && c != '\r')
+                        c = buffer.snextc();
+                }
+                else if (c != traits::eof() && is_netpbm_space(c))
+                {
+                    buffer.sbumpc();
+                }
+                else
+                {
+                    break;
+                }
+                separated = true;
+            }
+
+            char digits[16];
+            std::size_t length = 0;
+            for (int c = buffer.sgetc(); c >= '0' && c <= '9' && length < sizeof(digits); c = buffer.snextc())
+                digits[length++] = static_cast<char>(c);
+            const parse_result<Integer> result = parse<Integer, fail_only>(std::string_view(digits, length));
+            if (!separated || length == 0 || length == sizeof(digits) || !result)
+                return false;
+            value = result.value;
+            return true;
+        }
+
+        inline std::string format_netpbm_header(const netpbm_header& header)
+        {
+            std::string text{ 'P', static_cast<char>('0' + static_cast<int>(header.format)), '\n' };
+            text += std::to_string(header.width);
+            text += ' ';
+            text += std::to_string(header.height);
+            text += '\n';
+            text += std::to_string(header.maxval);
+            text += '\n';
+            return text;
+        }
+
+        // The number of samples on each line of plain output: as many of the widest sample as fit in
+        //  a line, rounded down to whole pixels.
+        inline std::size_t netpbm_samples_per_line(const netpbm_header& header)
+        {
+            const std::size_t width = std::to_string(header.maxval).size() + 1;
+            const std::size_t samples = (netpbm_line_length + 1) / width;
+            return samples - samples % header.channels();
+        }
+
+        // Formats one row of plain samples, starting a new line every samples_per_line samples, and
+        //  returns the end. The room available must be at least netpbm_row_capacity().
+        template <typename Sample>
+        char* format_netpbm_row(char* out, const Sample* const samples, const std::size_t count, const std::size_t samples_per_line)
+        {
+            for (std::size_t i = 0; i < count; i += samples_per_line)
+            {
+                out = format_values<netpbm_policy, false>(out, samples + i, std::min(samples_per_line, count - i));
+                out[-1] = '\n';
+            }
+            return out;
+        }
+
+        template <typename Sample>
+        std::size_t netpbm_row_capacity(const std::size_t count)
+        {
+            return count * (std::numeric_limits<Sample>::digits10 + 2);
+        }
+
+        // True if no sample is greater than the maximum.
+        template <typename Sample>
+        bool within_maxval(const Sample* const samples, const std::size_t count, const unsigned maxval)
+        {
+            unsigned largest = 0;
+            for (std::size_t i = 0; i < count; ++i)
+                largest = std::max<unsigned>(largest, samples[i]);
+            return largest <= maxval;
+        }
+
+        // Reads the plain samples which follow the header, up to the end of the input (the plain
+        //  formats only hold one image). Batches of text are split into blocks at whitespace, and each
+        //  block is parsed on its own thread into its own buffer. Batches start small and double while
+        //  the input keeps filling them, up to about 4 MB per thread, but are no bigger than the
+        //  samples still to come need, so small images take little memory. The samples are appended
+        //  to the image as they're parsed, so a header which claims more samples than there are
+        //  doesn't allocate them.
+        template <typename Sample>
+        bool read_plain_samples(std::streambuf& buffer, netpbm_image<Sample>& image, const std::size_t total, const std::size_t threads)
+        {
+            const std::size_t thread_count = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+            const std::size_t max_batch_size = thread_count << 22;
+            constexpr std::size_t min_batch_size = 4096;
+            std::size_t step = std::size_t{ 1 } << 16;
+            std::string text;
+            std::vector<std::vector<Sample>> parsed(thread_count);
+            bool at_end = false;
+            while (!at_end)
+            {
+                // Top up the batch, which starts with whatever was left of the last one.
+                const std::size_t remaining = total - image.samples.size();
+                const std::size_t carried = text.size();
+                const std::size_t batch_size = std::max(std::min(step, netpbm_row_capacity<Sample>(std::min(remaining, max_batch_size))), carried + min_batch_size);
+                text.resize(batch_size);
+                const auto read = buffer.sgetn(&text[carried], static_cast<std::streamsize>(batch_size - carried));
+                text.resize(carried + static_cast<std::size_t>(read));
+                at_end = text.size() < batch_size;
+                step = std::min(step * 2, max_batch_size);
+                INTEGRAL_IO_PROBE1(buffer_refill, read);
+
+                std::atomic<bool> failed{ false };
+                const text_blocks split = parallel_text_blocks(text, at_end, thread_count, is_netpbm_space, [&](const std::size_t block, const std::string_view chunk)
+                {
+                    std::vector<Sample>& samples = parsed[block];
+                    samples.resize(count_tokens(chunk));
+                    const bulk_parse_result result = parse<netpbm_policy>(chunk, samples.data(), samples.size());
+                    if (!result || !std::all_of(chunk.begin() + static_cast<std::ptrdiff_t>(result.consumed), chunk.end(), is_space) ||
+                        !within_maxval(samples.data(), samples.size(), image.header.maxval))
+                        failed.store(true, std::memory_order_relaxed);
+                });
+                if (split.blocks == 0 || failed)
+                    return false;
+
+                for (std::size_t block = 0; block < split.blocks; ++block)
+                {
+                    if (parsed[block].size() > total - image.samples.size())
+                        return false;
+                    image.samples.insert(image.samples.end(), parsed[block].begin(), parsed[block].end());
+                }
+                text.erase(0, split.end);
+            }
+            return image.samples.size() == total;
+        }
+
+        // Reads the raw samples which follow the header, which are big-endian if they take 2 bytes.
+        //  They're read a chunk at a time and appended to the image, so a header which claims more
+        //  samples than there are doesn't allocate them.
+        template <typename Sample>
+        bool read_raw_samples(std::streambuf& buffer, netpbm_image<Sample>& image, const std::size_t total)
+        {
+            constexpr std::size_t chunk = std::size_t{ 1 } << 20;
+            const std::size_t sample_size = image.header.maxval <= 0xFF ? 1 : 2;
+            std::vector<unsigned char> bytes;
+            while (image.samples.size() < total)
+            {
+                const std::size_t first = image.samples.size();
+                const std::size_t count = std::min(chunk, total - first);
+                image.samples.resize(first + count);
+
+                // Samples of the file's size are read straight into the image.
+                unsigned char* data = reinterpret_cast<unsigned char*>(image.samples.data() + first);
+                if (sizeof(Sample) != sample_size)
+                {
+                    bytes.resize(count * sample_size);
+                    data = bytes.data();
+                }
+                if (static_cast<std::size_t>(buffer.sgetn(reinterpret_cast<char*>(data), static_cast<std::streamsize>(count * sample_size))) != count * sample_size)
+                    return false;
+                if (sample_size == 2)
+                {
+                    for (std::size_t i = 0; i < count; ++i)
+                        image.samples[first + i] = static_cast<Sample>(data[2 * i] << 8 | data[2 * i + 1]);
+                }
+                else if (sizeof(Sample) != 1)
+                {
+                    std::copy(bytes.begin(), bytes.end(), image.samples.begin() + static_cast<std::ptrdiff_t>(first));
+                }
+                if (!within_maxval(image.samples.data() + first, count, image.header.maxval))
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    // Reads a Netpbm header, up to and including the single whitespace character after the maxval.
+    //  If it isn't a valid P2, P3, P5 or P6 header, the stream's failbit is set.
+    inline std::istream& read_netpbm_header(std::istream& is, netpbm_header& header)
+    {
+        std::streambuf* const buffer = is.rdbuf();
+        const std::istream::sentry sentry{ is, true };
+        bool valid = false;
+        if (sentry && buffer && buffer->sbumpc() == 'P')
+        {
+            const int format = buffer->sbumpc() - '0';
+            valid = (format == 2 || format == 3 || format == 5 || format == 6) &&
+                detail::read_netpbm_number(*buffer, header.width) && detail::read_netpbm_number(*buffer, header.height) &&
+                detail::read_netpbm_number(*buffer, header.maxval) && header.maxval != 0 && header.maxval <= 0xFFFF &&
+                detail::is_netpbm_space(buffer->sbumpc());
+            header.format = static_cast<netpbm_format>(format);
+        }
+        if (!valid)
+            is.setstate(std::ios_base::failbit);
+        return is;
+    }
+
+    // Reads a whole image. Plain samples are parsed in parallel, a batch at a time, to the end of
+    //  the input; a thread count of 0 means one per hardware thread. Raw images are read to the end
+    //  of their samples, so one file can hold several. Memory for the samples grows as they're read,
+    //  rather than being allocated for the header's size up front. If anything is invalid, a sample
+    //  is greater than the maxval, the maxval is too big for the sample type, or there isn't enough
+    //  memory, the stream's failbit is set.
+    template <typename Sample>
+    std::istream& read_netpbm(std::istream& is, netpbm_image<Sample>& image, const std::size_t threads = 0)
+    {
+        if (!read_netpbm_header(is, image.header))
+            return is;
+
+        const std::size_t count = detail::netpbm_sample_count(image.header);
+        if ((count == 0 && image.header.width != 0 && image.header.height != 0) || image.header.maxval > std::numeric_limits<Sample>::max())
+        {
+            is.setstate(std::ios_base::failbit);
+            return is;
+        }
+
+        INTEGRAL_IO_PROBE1(batch_begin, count);
+        image.samples.clear();
+        bool valid = false;
+        try
+        {
+            valid = image.header.is_plain() ? detail::read_plain_samples(*is.rdbuf(), image, count, threads) : detail::read_raw_samples(*is.rdbuf(), image, count);
+        }
+        catch (const std::exception&)
+        {
+            // There wasn't enough memory for the samples.
+        }
+        if (!valid)
+            is.setstate(std::ios_base::failbit);
+        INTEGRAL_IO_PROBE2(batch_end, valid ? count : 0, count);
+        return is;
+    }
+
+    // Writes a whole image in its header's format. Each row of plain samples starts on a new line,
+    //  and is wrapped at whole pixels so that no line is longer than 70 characters. Rows are
+    //  formatted in parallel, a batch at a time; a thread count of 0 means one per hardware thread.
+    //  If the samples don't match the header, or one is greater than the maxval, nothing is written
+    //  and the stream's failbit is set.
+    template <typename Sample>
+    std::ostream& write_netpbm(std::ostream& os, const netpbm_image<Sample>& image, const std::size_t threads = 0)
+    {
+        const netpbm_header& header = image.header;
+        const std::size_t count = detail::netpbm_sample_count(header);
+        if (image.samples.size() != count || (count == 0 && header.width != 0 && header.height != 0) || header.maxval == 0 ||
+            header.maxval > 0xFFFF || !detail::within_maxval(image.samples.data(), count, header.maxval))
+        {
+            os.setstate(std::ios_base::failbit);
+            return os;
+        }
+
+        INTEGRAL_IO_PROBE1(batch_begin, count);
+        os << detail::format_netpbm_header(header);
+        if (!header.is_plain())
+        {
+            if (header.maxval <= 0xFF && sizeof(Sample) == 1)
+            {
+                os.write(reinterpret_cast<const char*>(image.samples.data()), static_cast<std::streamsize>(count));
+            }
+            else
+            {
+                const std::size_t sample_size = header.maxval <= 0xFF ? 1 : 2;
+                std::vector<char> bytes(count * sample_size);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    if (sample_size == 2)
+                        bytes[2 * i] = static_cast<char>(image.samples[i] >> 8);
+                    bytes[sample_size * i + sample_size - 1] = static_cast<char>(image.samples[i] & 0xFF);
+                }
+                os.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            }
+            INTEGRAL_IO_PROBE2(batch_end, count, count);
+            return os;
+        }
+
+        // Each block of rows is formatted into its own buffer. A batch is about 4 MB of text per thread.
+        const std::size_t row_size = header.row_size();
+        const std::size_t samples_per_line = detail::netpbm_samples_per_line(header);
+        const std::size_t row_capacity = detail::netpbm_row_capacity<Sample>(row_size);
+        const std::size_t rows_per_block = std::max<std::size_t>(1, (std::size_t{ 4 } << 20) / std::max<std::size_t>(row_capacity, 1));
+        const std::size_t thread_count = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::vector<char>> buffers(thread_count);
+        std::vector<std::size_t> lengths(thread_count);
+
+        for (std::size_t batch = 0; batch < header.height && os; batch += rows_per_block * thread_count)
+        {
+            const std::size_t batch_rows = std::min(header.height - batch, rows_per_block * thread_count);
+            const std::size_t blocks = (batch_rows + rows_per_block - 1) / rows_per_block;
+            detail::parallel_blocks(blocks, thread_count, 1, [&](const std::size_t first_block, const std::size_t last_block)
+            {
+                for (std::size_t block = first_block; block < last_block; ++block)
+                {
+                    const std::size_t first_row = batch + block * rows_per_block;
+                    const std::size_t last_row = std::min(first_row + rows_per_block, batch + batch_rows);
+                    std::vector<char>& buffer = buffers[block];
+                    buffer.resize((last_row - first_row) * row_capacity + detail::format_slack);
+                    char* out = buffer.data();
+                    for (std::size_t row = first_row; row < last_row; ++row)
+                        out = detail::format_netpbm_row(out, image.samples.data() + row * row_size, row_size, samples_per_line);
+                    lengths[block] = static_cast<std::size_t>(out - buffer.data());
+                }
+            });
+            for (std::size_t block = 0; block < blocks && os; ++block)
+            {
+                INTEGRAL_IO_PROBE1(buffer_refill, lengths[block]);
+                os.write(buffers[block].data(), static_cast<std::streamsize>(lengths[block]));
+            }
+        }
+        INTEGRAL_IO_PROBE2(batch_end, count, count);
+        return os;
+    }
+}
@@ -0,0 +1,432 @@
+#pragma once
+
+#include "integral_io.hpp"
+#include "integral_io_mmap.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Reading and writing NumPy .npy files of integers, and converting them to and from text. A .npy
+//  file is a short header, which is a Python dict literal such as
+//
+//      {'descr': '<i4', 'fortran_order': False, 'shape': (3, 4), }
+//
+//  followed by the values themselves. The dtypes supported are signed (i) and unsigned (u) integers
+//  of 1, 2, 4 or 8 bytes, in either byte order. Reading works on memory (usually a mapped_file), so
+//  the values are never copied unless they're asked for.
+
+namespace integral_io
+{
+    // An integer dtype, e.g. '<i4' or '|u1'.
+    struct npy_dtype
+    {
+        bool is_signed = true;
+        std::size_t size = 4;
+        endian order = endian::native;
+
+        template <typename Integer>
+        static npy_dtype of(const endian order = endian::native)
+        {
+            static_assert(std::is_integral<Integer>::value && sizeof(Integer) <= 8, ".npy files hold integers of up to 8 bytes");
+            return npy_dtype{ std::is_signed<Integer>::value, sizeof(Integer), order };
+        }
+
+        // True if the values are of the given type (in either byte order).
+        template <typename Integer>
+        bool is() const
+        {
+            return std::is_integral<Integer>::value && !std::is_same<Integer, bool>::value && is_signed == std::is_signed<Integer>::value && size == sizeof(Integer);
+        }
+
+        std::string descr() const
+        {
+            return { size == 1 ? '|' : order == endian::little ? '<' : '>', is_signed ? 'i' : 'u', static_cast<char>('0' + size) };
+        }
+    };
+
+    struct npy_header
+    {
+        npy_dtype dtype;
+        bool fortran_order = false;
+        std::vector<std::size_t> shape;
+
+        // The number of values, which is 1 for an array of no dimensions.
+        std::size_t count() const
+        {
+            std::size_t count = 1;
+            for (const std::size_t dimension : shape)
+                count *= dimension;
+            return count;
+        }
+    };
+
+    namespace detail
+    {
+        constexpr std::string_view npy_magic{ "\x93NUMPY", 6 };
+
+        // The header text and the values after it are aligned to this many bytes.
+        constexpr std::size_t npy_alignment = 64;
+
+        // Parses the dict in a .npy header. The keys may be in any order, but there must be exactly
+        //  the three NumPy writes.
+        inline bool parse_npy_header(const std::string_view text, npy_header& header)
+        {
+            const char* p = text.data();
+            const char* const last = p + text.size();
+            const auto skip_spaces = [&p, last]()
+            {
+                while (p != last && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+                    ++p;
+            };
+            const auto expect = [&](const std::string_view token)
+            {
+                skip_spaces();
+                if (static_cast<std::size_t>(last - p) < token.size() || std::string_view(p, token.size()) != token)
+                    return false;
+                p += token.size();
+                return true;
+            };
+            const auto quoted = [&](std::string_view& value)
+            {
+                skip_spaces();
+                if (p == last || (*p != '\'' && *p != '"'))
+                    return false;
+                const char* const close = std::find(p + 1, last, *p);
+                if (close == last)
+                    return false;
+                value = std::string_view(p + 1, static_cast<std::size_t>(close - p - 1));
+                p = close + 1;
+                return true;
+            };
+
+            bool has_descr = false;
+            bool has_fortran_order = false;
+            bool has_shape = false;
+            if (!expect("{"))
+                return false;
+            while (!expect("}"))
+            {
+                std::string_view key;
+                if (!quoted(key) || !expect(":"))
+                    return false;
+                if (key == "descr" && !has_descr)
+                {
+                    std::string_view descr;
+                    if (!quoted(descr) || descr.size() != 3 || (descr[1] != 'i' && descr[1] != 'u') ||
+                        (descr[2] != '1' && descr[2] != '2' && descr[2] != '4' && descr[2] != '8'))
+                        return false;
+                    header.dtype.is_signed = descr[1] == 'i';
+                    header.dtype.size = static_cast<std::size_t>(descr[2] - '0');
+                    if (descr[0] == '<' || (descr[0] == '|' && header.dtype.size == 1))
+                        header.dtype.order = endian::little;
+                    else if (descr[0] == '>')
+                        header.dtype.order = endian::big;
+                    else if (descr[0] == '=')
+                        header.dtype.order = endian::native;
+                    else
+                        return false;
+                    has_descr = true;
+                }
+                else if (key == "fortran_order" && !has_fortran_order)
+                {
+                    if (expect("True"))
+                        header.fortran_order = true;
+                    else if (expect("False"))
+                        header.fortran_order = false;
+                    else
+                        return false;
+                    has_fortran_order = true;
+                }
+                else if (key == "shape" && !has_shape)
+                {
+                    header.shape.clear();
+                    if (!expect("("))
+                        return false;
+                    while (!expect(")"))
+                    {
+                        skip_spaces();
+                        const auto dimension = parse<std::size_t, fail_only>(std::string_view(p, static_cast<std::size_t>(last - p)));
+                        if (p == last || *p < '0' || *p > '9' || !dimension)
+                            return false;
+                        header.shape.push_back(dimension.value);
+                        p += dimension.consumed;
+                        if (expect(","))
+                            continue;
+                        if (!expect(")"))
+                            return false;
+                        break;
+                    }
+                    has_shape = true;
+                }
+                else
+                {
+                    return false;
+                }
+                if (expect(","))
+                    continue;
+                if (!expect("}"))
+                    return false;
+                break;
+            }
+            skip_spaces();
+            return p == last && has_descr && has_fortran_order && has_shape;
+        }
+
+        inline std::string format_npy_header(const npy_header& header)
+        {
+            std::string dict = "{'descr': '" + header.dtype.descr() + "', 'fortran_order': " + (header.fortran_order ? "True" : "False") + ", 'shape': (";
+            for (std::size_t i = 0; i < header.shape.size(); ++i)
+            {
+                dict += std::to_string(header.shape[i]);
+                dict += header.shape.size() == 1 ? "," : i + 1 < header.shape.size() ? ", " : "";
+            }
+            dict += "), }";
+
+            // Version 1.0 has a 2-byte header length, and 2.0 a 4-byte one.
+            const bool long_header = npy_magic.size() + 4 + dict.size() + 1 > 0xFFFF;
+            const std::size_t prefix = npy_magic.size() + (long_header ? 6 : 4);
+            const std::size_t length = (prefix + dict.size() + 1 + npy_alignment - 1) / npy_alignment * npy_alignment - prefix;
+            dict.resize(length - 1, ' ');
+            dict += '\n';
+
+            std::string text{ npy_magic };
+            text += static_cast<char>(long_header ? 2 : 1);
+            text += '\0';
+            for (std::size_t i = 0; i < (long_header ? 4u : 2u); ++i)
+                text += static_cast<char>((length >> (8 * i)) & 0xFF);
+            return text + dict;
+        }
+
+        // A policy as given, but with values separated by spaces. Text with another delimiter is read
+        //  by turning its delimiters into spaces first.
+        template <typename Policy>
+        struct space_delimited : Policy
+        {
+            static constexpr char delimiter = ' ';
+        };
+
+        // The longest text of any value of the type, with the policy's formatting.
+        template <typename Policy, typename Integer>
+        constexpr std::size_t max_formatted_length = custom_format<Policy, Integer> ? custom_format_length<Policy, integral_io_t<Integer>> : max_decimal_length<integral_io_t<Integer>>;
+    }
+
+    // A read-only view of a .npy file in memory. The memory must outlive the view.
+    class npy_array
+    {
+    public:
+        npy_array() = default;
+
+        // Parses the header. If it's not a valid .npy file of integers, or is too short for its
+        //  values, the array is left invalid.
+        npy_array(const void* const data, const std::size_t size)
+        {
+            const auto* const bytes = static_cast<const unsigned char*>(data);
+            if (size < detail::npy_magic.size() + 4 || std::memcmp(bytes, detail::npy_magic.data(), detail::npy_magic.size()) != 0)
+                return;
+
+            const unsigned major = bytes[6];
+            std::size_t offset = detail::npy_magic.size() + 2;
+            std::size_t length = bytes[offset] | static_cast<std::size_t>(bytes[offset + 1]) << 8;
+            offset += 2;
+            if (major == 2 || major == 3)
+            {
+                if (size < offset + 2)
+                    return;
+                length |= static_cast<std::size_t>(bytes[offset]) << 16 | static_cast<std::size_t>(bytes[offset + 1]) << 24;
+                offset += 2;
+            }
+            else if (major != 1)
+            {
+                return;
+            }
+            if (size - offset < length || !detail::parse_npy_header(std::string_view(reinterpret_cast<const char*>(bytes + offset), length), m_header))
+                return;
+
+            // The values must all be there, which also means their total size can't overflow. An
+            //  empty shape is a single value.
+            if (std::find(m_header.shape.begin(), m_header.shape.end(), 0) == m_header.shape.end())
+            {
+                std::size_t available = (size - offset - length) / m_header.dtype.size;
+                for (const std::size_t dimension : m_header.shape)
+                {
+                    if (available < dimension)
+                        return;
+                    available /= dimension;
+                }
+                if (available == 0)
+                    return;
+            }
+            m_values = bytes + offset + length;
+            m_valid = true;
+        }
+
+        explicit npy_array(const mapped_file& file) : npy_array(file.data(), file.size()) {}
+
+        bool is_valid() const { return m_valid; }
+        explicit operator bool() const { return m_valid; }
+        const npy_header& header() const { return m_header; }
+        std::size_t size() const { return m_valid ? m_header.count() : 0; }
+
+        // True if the array's dtype is the given type (in either byte order).
+        template <typename Integer>
+        bool holds() const { return m_valid && m_header.dtype.is<Integer>(); }
+
+        // The values, in the file's order. If the array doesn't hold the given type, the span is empty.
+        template <typename Integer>
+        endian_span<Integer> values() const
+        {
+            if (!holds<Integer>())
+                return {};
+            return endian_span<Integer>(m_values, m_header.count(), m_header.dtype.order);
+        }
+
+        // Calls function(values) with the values as an endian_span of the array's own type.
+        template <typename Function>
+        decltype(auto) visit(Function&& function) const
+        {
+            switch (m_header.dtype.size * 2 + (m_header.dtype.is_signed ? 1 : 0))
+            {
+            case 2: return function(values<std::uint8_t>());
+            case 3: return function(values<std::int8_t>());
+            case 4: return function(values<std::uint16_t>());
+            case 5: return function(values<std::int16_t>());
+            case 8: return function(values<std::uint32_t>());
+            case 9: return function(values<std::int32_t>());
+            case 16: return function(values<std::uint64_t>());
+            default: return function(values<std::int64_t>());
+            }
+        }
+
+    private:
+        npy_header m_header;
+        const unsigned char* m_values = nullptr;
+        bool m_valid = false;
+    };
+
+    // Writes a .npy file of the given shape, with the values in the given byte order.
+    template <typename Integer>
+    std::ostream& write_npy(std::ostream& os, const Integer* const values, const std::vector<std::size_t>& shape, const endian order = endian::native)
+    {
+        npy_header header;
+        header.dtype = npy_dtype::of<Integer>(order);
+        header.shape = shape;
+        const std::size_t count = header.count();
+        INTEGRAL_IO_PROBE1(batch_begin, count);
+        os << detail::format_npy_header(header);
+        if (header.dtype.size == 1 || order == endian::native)
+        {
+            os.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count * sizeof(Integer)));
+        }
+        else
+        {
+            // Swapped a chunk at a time with the vectorised byte swap.
+            constexpr std::size_t chunk = 8192;
+            std::vector<Integer> swapped(std::min(chunk, count));
+            for (std::size_t i = 0; i < count && os; i += chunk)
+            {
+                const std::size_t n = std::min(chunk, count - i);
+                detail::copy_integers(reinterpret_cast<const unsigned char*>(values + i), n, true, swapped.data());
+                INTEGRAL_IO_PROBE1(buffer_refill, n * sizeof(Integer));
+                os.write(reinterpret_cast<const char*>(swapped.data()), static_cast<std::streamsize>(n * sizeof(Integer)));
+            }
+        }
+        INTEGRAL_IO_PROBE2(batch_end, count, count);
+        return os;
+    }
+
+    // Writes an array's values as text, as numpy.savetxt() lays it out: one row (the last dimension)
+    //  per line for arrays of two or more dimensions, and one value per line otherwise. Values are
+    //  separated by the policy's delimiter and formatted with the bulk formatter, so 1-byte dtypes
+    //  come out as numbers. If the array is invalid, or is in Fortran order with more than one
+    //  dimension, nothing is written and the stream's failbit is set.
+    template <typename Policy = default_policy>
+    std::ostream& write_npy_text(std::ostream& os, const npy_array& array)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "write_npy_text() requires a policy derived from default_policy");
+        const npy_header& header = array.header();
+        if (!array || (header.fortran_order && header.shape.size() > 1))
+        {
+            os.setstate(std::ios_base::failbit);
+            return os;
+        }
+
+        const std::size_t row_size = header.shape.size() > 1 ? header.shape.back() : 1;
+        array.visit([&os, row_size](const auto values)
+        {
+            using integer_type = typename decltype(values)::value_type;
+            constexpr std::size_t length = detail::max_formatted_length<Policy, integer_type> + 1;
+            const std::size_t rows_per_chunk = std::max<std::size_t>(1, (std::size_t{ 1 } << 16) / std::max<std::size_t>(row_size, 1));
+            std::vector<integer_type> chunk(rows_per_chunk * row_size);
+            std::vector<char> text(chunk.size() * length + detail::format_slack);
+            INTEGRAL_IO_PROBE1(batch_begin, values.size());
+            for (std::size_t first = 0; first < values.size() && os; first += chunk.size())
+            {
+                const std::size_t count = std::min(chunk.size(), values.size() - first);
+                values.copy_to(first, count, chunk.data());
+                char* out = text.data();
+                for (std::size_t row = 0; row < count; row += row_size)
+                {
+                    out = detail::format_values<Policy, false>(out, chunk.data() + row, row_size);
+                    out[-1] = '\n';
+                }
+                INTEGRAL_IO_PROBE1(buffer_refill, out - text.data());
+                os.write(text.data(), out - text.data());
+            }
+            INTEGRAL_IO_PROBE2(batch_end, values.size(), values.size());
+        });
+        return os;
+    }
+
+    // Reads text laid out as write_npy_text() writes it, and writes it to npy as a .npy file: a
+    //  2-dimensional array, or a 1-dimensional one if each line has one value. Blank lines are
+    //  skipped. Values are parsed with the bulk parser and the policy's grammar, and separated by
+    //  the policy's delimiter, so whatever write_npy_text<Policy>() writes reads back the same. (A
+    //  delimiter other than whitespace is turned into a space first; in the stream grammar, that
+    //  means empty fields such as "1,,2" are skipped.) If any value is invalid or out of range, or
+    //  the lines have different numbers of values, nothing is written and the text stream's failbit
+    //  is set.
+    template <typename Integer, typename Policy = default_policy>
+    std::istream& read_npy_text(std::istream& is, std::ostream& npy, const endian order = endian::native)
+    {
+        static_assert(std::is_base_of<default_policy, Policy>::value, "read_npy_text() requires a policy derived from default_policy");
+        static_assert(std::is_integral<Integer>::value && sizeof(Integer) <= 8, ".npy files hold integers of up to 8 bytes");
+        std::vector<Integer> values;
+        std::vector<Integer> row;
+        std::string line;
+        std::size_t rows = 0;
+        std::size_t columns = 0;
+        while (std::getline(is, line))
+        {
+            if (std::all_of(line.begin(), line.end(), detail::is_space))
+                continue;
+
+            if constexpr (!detail::is_space(Policy::delimiter))
+                std::replace(line.begin(), line.end(), Policy::delimiter, ' ');
+            row.resize(detail::count_tokens(line));
+            const bulk_parse_result result = parse<detail::space_delimited<Policy>>(line, row.data(), row.size());
+            if (!result || !std::all_of(line.begin() + static_cast<std::ptrdiff_t>(result.consumed), line.end(), detail::is_space) ||
+                (rows != 0 && row.size() != columns))
+            {
+                is.setstate(std::ios_base::failbit);
+                return is;
+            }
+            columns = row.size();
+            values.insert(values.end(), row.begin(), row.end());
+            ++rows;
+        }
+        if (is.bad())
+            return is;
+
+        is.clear(is.rdstate() & ~std::ios_base::failbit);
+        write_npy(npy, values.data(), columns == 1 || rows == 0 ? std::vector<std::size_t>{ rows } : std::vector<std::size_t>{ rows, columns }, order);
+        return is;
+    }
+}
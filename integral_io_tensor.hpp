@@ -0,0 +1,517 @@
+#pragma once
+
+#include "integral_io.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Text import and export for quantised tensors of 1-byte values, e.g. int8 model weights. The text
+//  form is meant for diffing and review, so each row of the tensor is one line:
+//
+//      tensor i8 2x3 per_row
+//      0.0125 -3 | 1 -2 3
+//      0.5 0 | -128 0 127
+//
+// The header gives the element type (i8 or u8), the shape, and the quantisation. With per_row
+//  quantisation, each line starts with that row's scale and zero point; with per_tensor, the header
+//  ends with the single scale and zero point, and the lines hold only values. A row is one index of
+//  the first dimension (all of a 1-dimensional tensor is one row), so per_row is also per output
+//  channel for weights laid out as [out, in, ...]. Scales are written as the shortest text which
+//  reads back to the same float.
+
+namespace integral_io
+{
+    // How a tensor's values map to real numbers: real = scale * (value - zero_point).
+    enum class quantisation
+    {
+        per_tensor, // One scale and zero point for the whole tensor.
+        per_row,    // One scale and zero point for each row.
+    };
+
+    struct quantisation_params
+    {
+        float scale = 1.0f;
+        std::int32_t zero_point = 0;
+    };
+
+    // The first line of a tensor's text form.
+    struct tensor_header
+    {
+        bool is_signed = true;
+        std::vector<std::size_t> shape;
+        quantisation mode = quantisation::per_tensor;
+        quantisation_params params; // Only for per_tensor.
+
+        std::size_t rows() const
+        {
+            if (shape.empty())
+                return 0;
+            return shape.size() == 1 ? 1 : shape[0];
+        }
+
+        // The number of values in each row. Only meaningful if the shape fits (see
+        //  detail::tensor_shape_fits()), which parsed headers always do.
+        std::size_t row_size() const
+        {
+            if (shape.empty())
+                return 0;
+            std::size_t size = 1;
+            for (std::size_t i = shape.size() == 1 ? 0 : 1; i < shape.size(); ++i)
+                size *= shape[i];
+            return size;
+        }
+    };
+
+    // A whole tensor in memory. The values are in row-major order, and params holds one entry for
+    //  per_tensor quantisation or one per row for per_row.
+    template <typename Byte>
+    struct quantised_tensor
+    {
+        static_assert(std::is_integral<Byte>::value && sizeof(Byte) == 1, "quantised tensors hold 1-byte integers");
+
+        std::vector<std::size_t> shape;
+        quantisation mode = quantisation::per_tensor;
+        std::vector<quantisation_params> params;
+        std::vector<Byte> values;
+
+        tensor_header header() const
+        {
+            tensor_header h;
+            h.is_signed = std::is_signed<Byte>::value;
+            h.shape = shape;
+            h.mode = mode;
+            if (mode == quantisation::per_tensor && !params.empty())
+                h.params = params[0];
+            return h;
+        }
+    };
+
+    namespace detail
+    {
+        // Rows are strict: single spaces between values, and a newline at the end. Values are copied
+        //  from the 1-byte output table, and read back by the bulk parser's 1-byte fast path.
+        struct tensor_policy : strict
+        {
+            static constexpr output_table table = output_table::bytes;
+        };
+
+        // The most characters a row's scale and zero point can take, e.g. "-1.17549435e-38 -2147483648 | ".
+        constexpr std::size_t tensor_params_length = 48;
+
+        // An upper bound on the length of a row's line, including the slack bulk formatting needs.
+        inline std::size_t tensor_line_capacity(const std::size_t row_size)
+        {
+            return tensor_params_length + row_size * 5 + 1 + format_slack;
+        }
+
+        // True if the number of values in the tensor, and the longest line a row can take, fit in a
+        //  size_t.
+        inline bool tensor_shape_fits(const tensor_header& header)
+        {
+            constexpr std::size_t max = std::numeric_limits<std::size_t>::max();
+            std::size_t row_size = 1;
+            for (std::size_t i = header.shape.size() == 1 ? 0 : 1; i < header.shape.size(); ++i)
+            {
+                if (header.shape[i] != 0 && row_size > max / header.shape[i])
+                    return false;
+                row_size *= header.shape[i];
+            }
+            const std::size_t rows = header.rows();
+            if (rows != 0 && row_size > max / rows)
+                return false;
+            return row_size <= (max - tensor_params_length - 1 - format_slack) / 5;
+        }
+
+        inline char* format_params(char* out, const quantisation_params& params)
+        {
+            out = std::to_chars(out, out + 16, params.scale).ptr;
+            *out++ = ' ';
+            return std::to_chars(out, out + 12, params.zero_point).ptr;
+        }
+
+        // Formats one row as a line, and returns its end. The room available must be at least
+        //  tensor_line_capacity(count).
+        template <typename Byte>
+        char* format_tensor_row(char* out, const Byte* const values, const std::size_t count, const quantisation_params* const params)
+        {
+            if (params)
+            {
+                out = format_params(out, *params);
+                std::memcpy(out, " | ", 3);
+                out += 3;
+            }
+            out = format_values<tensor_policy, false>(out, values, count);
+            if (count != 0)
+                --out;
+            *out++ = '\n';
+            return out;
+        }
+
+        // Parses a scale and zero point from the start of [first, last), and returns the end of them, or
+        //  nullptr if they aren't valid.
+        inline const char* parse_params(const char* first, const char* const last, quantisation_params& params)
+        {
+            const auto scale = std::from_chars(first, last, params.scale);
+            if (scale.ec != std::errc() || scale.ptr == last || *scale.ptr != ' ')
+                return nullptr;
+            first = scale.ptr + 1;
+            const auto zero_point = parse<std::int32_t>(std::string_view(first, static_cast<std::size_t>(last - first)));
+            if (!zero_point)
+                return nullptr;
+            params.zero_point = zero_point.value;
+            return first + zero_point.consumed;
+        }
+
+        // Parses one row's line, where last points at the newline which ends it.
+        template <typename Byte>
+        bool parse_tensor_row(const char* first, const char* const last, Byte* const values, const std::size_t count, quantisation_params* const params)
+        {
+            if (params)
+            {
+                first = parse_params(first, last, *params);
+                if (!first || last - first < 3 || std::memcmp(first, " | ", 3) != 0)
+                    return false;
+                first += 3;
+            }
+            if (count == 0)
+                return first == last;
+
+            const auto result = parse<tensor_policy>(std::string_view(first, static_cast<std::size_t>(last - first) + 1), values, count);
+            return result && result.consumed == static_cast<std::size_t>(last - first) + 1;
+        }
+
+        inline std::string format_tensor_header(const tensor_header& header)
+        {
+            std::string text = header.is_signed ? "tensor i8 " : "tensor u8 ";
+            for (std::size_t i = 0; i < header.shape.size(); ++i)
+            {
+                if (i != 0)
+                    text += 'x';
+                text += std::to_string(header.shape[i]);
+            }
+            if (header.mode == quantisation::per_row)
+            {
+                text += " per_row\n";
+            }
+            else
+            {
+                char buffer[tensor_params_length];
+                text += " per_tensor ";
+                text.append(buffer, format_params(buffer, header.params));
+                text += '\n';
+            }
+            return text;
+        }
+
+        inline bool parse_tensor_header(const std::string_view line, tensor_header& header)
+        {
+            const char* p = line.data();
+            const char* const last = p + line.size();
+            const auto expect = [&p, last](const std::string_view text)
+            {
+                if (static_cast<std::size_t>(last - p) < text.size() || std::string_view(p, text.size()) != text)
+                    return false;
+                p += text.size();
+                return true;
+            };
+
+            if (!expect("tensor "))
+                return false;
+            if (expect("i8 "))
+                header.is_signed = true;
+            else if (expect("u8 "))
+                header.is_signed = false;
+            else
+                return false;
+
+            header.shape.clear();
+            do
+            {
+                const auto dimension = parse<std::size_t>(std::string_view(p, static_cast<std::size_t>(last - p)));
+                if (p == last || *p < '0' || *p > '9' || !dimension)
+                    return false;
+                header.shape.push_back(dimension.value);
+                p += dimension.consumed;
+            } while (expect("x"));
+            if (!tensor_shape_fits(header))
+                return false;
+
+            if (expect(" per_row"))
+            {
+                header.mode = quantisation::per_row;
+                return p == last;
+            }
+            if (!expect(" per_tensor "))
+                return false;
+            header.mode = quantisation::per_tensor;
+            const char* const end = parse_params(p, last, header.params);
+            return end == last;
+        }
+
+        // Reads a line without its newline. Returns false at the end of the input, or if the line
+        //  doesn't end with a newline.
+        inline bool read_line(std::istream& is, std::string& line)
+        {
+            if (!std::getline(is, line))
+                return false;
+            if (is.eof())
+            {
+                is.setstate(std::ios_base::failbit);
+                return false;
+            }
+            return true;
+        }
+    }
+
+    // Writes a tensor one row at a time, so it never has to be in memory all at once.
+    template <typename Byte>
+    class tensor_writer
+    {
+        static_assert(std::is_integral<Byte>::value && sizeof(Byte) == 1, "quantised tensors hold 1-byte integers");
+
+    public:
+        // If the shape is too big to write, or the line buffer can't be allocated, nothing is written
+        //  and the stream's failbit is set.
+        tensor_writer(std::ostream& os, const tensor_header& header) : m_os{ os }, m_header{ header }, m_row_size{ header.row_size() }
+        {
+            m_header.is_signed = std::is_signed<Byte>::value;
+            try
+            {
+                if (detail::tensor_shape_fits(m_header))
+                    m_line.resize(detail::tensor_line_capacity(m_row_size));
+            }
+            catch (const std::exception&)
+            {
+            }
+            if (m_line.empty())
+                m_os.setstate(std::ios_base::failbit);
+            else
+                m_os << detail::format_tensor_header(m_header);
+        }
+
+        // Writes the next row of row_size() values. The params are only used for per_row
+        //  quantisation.
+        tensor_writer& write_row(const Byte* const values, const quantisation_params& params = {})
+        {
+            if (m_line.empty())
+            {
+                m_os.setstate(std::ios_base::failbit);
+                return *this;
+            }
+            const char* const end = detail::format_tensor_row(m_line.data(), values, m_row_size, m_header.mode == quantisation::per_row ? &params : nullptr);
+            INTEGRAL_IO_PROBE1(buffer_refill, end - m_line.data());
+            m_os.write(m_line.data(), static_cast<std::streamsize>(end - m_line.data()));
+            ++m_rows_written;
+            return *this;
+        }
+
+        std::size_t row_size() const { return m_row_size; }
+        std::size_t rows_written() const { return m_rows_written; }
+
+    private:
+        std::ostream& m_os;
+        tensor_header m_header;
+        std::size_t m_row_size;
+        std::vector<char> m_line;
+        std::size_t m_rows_written = 0;
+    };
+
+    // Reads a tensor one row at a time, so it never has to be in memory all at once. If the header
+    //  is invalid or is for the other signedness, the stream's failbit is set.
+    template <typename Byte>
+    class tensor_reader
+    {
+        static_assert(std::is_integral<Byte>::value && sizeof(Byte) == 1, "quantised tensors hold 1-byte integers");
+
+    public:
+        explicit tensor_reader(std::istream& is) : m_is{ is }
+        {
+            if (detail::read_line(m_is, m_line) && detail::parse_tensor_header(m_line, m_header) && m_header.is_signed == std::is_signed<Byte>::value)
+                m_row_size = m_header.row_size();
+            else
+                m_is.setstate(std::ios_base::failbit);
+        }
+
+        const tensor_header& header() const { return m_header; }
+        std::size_t row_size() const { return m_row_size; }
+
+        // Reads the next row of row_size() values and its quantisation parameters (which are the
+        //  header's for per_tensor quantisation). Returns false, and sets the stream's failbit, if
+        //  the row is missing or invalid.
+        bool read_row(Byte* const values, quantisation_params& params)
+        {
+            if (!m_is || m_rows_read == m_header.rows() || !detail::read_line(m_is, m_line))
+            {
+                m_is.setstate(std::ios_base::failbit);
+                return false;
+            }
+
+            // The row parser wants to see the newline after the last value.
+            m_line += '\n';
+            params = m_header.params;
+            const char* const first = m_line.data();
+            if (!detail::parse_tensor_row(first, first + m_line.size() - 1, values, m_row_size, m_header.mode == quantisation::per_row ? &params : nullptr))
+            {
+                m_is.setstate(std::ios_base::failbit);
+                return false;
+            }
+            ++m_rows_read;
+            return true;
+        }
+
+        std::size_t rows_read() const { return m_rows_read; }
+
+    private:
+        std::istream& m_is;
+        tensor_header m_header;
+        std::size_t m_row_size = 0;
+        std::string m_line;
+        std::size_t m_rows_read = 0;
+    };
+
+    // Writes a whole tensor. Rows are formatted in parallel, a batch at a time, and each batch is
+    //  written in order. A thread count of 0 means one per hardware thread. If the tensor's shape is
+    //  too big, or its values or params don't match it, nothing is written and the stream's failbit is set.
+    template <typename Byte>
+    std::ostream& write_tensor(std::ostream& os, const quantised_tensor<Byte>& tensor, const std::size_t threads = 0)
+    {
+        const tensor_header header = tensor.header();
+        const std::size_t rows = header.rows();
+        const std::size_t row_size = header.row_size();
+        const bool per_row = tensor.mode == quantisation::per_row;
+        if (!detail::tensor_shape_fits(header) || tensor.values.size() != rows * row_size || tensor.params.size() != (per_row ? rows : 1))
+        {
+            os.setstate(std::ios_base::failbit);
+            return os;
+        }
+
+        INTEGRAL_IO_PROBE1(batch_begin, rows);
+        os << detail::format_tensor_header(header);
+
+        // Each block is formatted into its own buffer. A batch is about 4 MB of text per thread.
+        const std::size_t line_capacity = detail::tensor_line_capacity(row_size);
+        const std::size_t rows_per_block = std::max<std::size_t>(1, (std::size_t{ 4 } << 20) / line_capacity);
+        const std::size_t thread_count = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::vector<char>> buffers(thread_count);
+        std::vector<std::size_t> lengths(thread_count);
+
+        for (std::size_t batch = 0; batch < rows && os; batch += rows_per_block * thread_count)
+        {
+            const std::size_t batch_rows = std::min(rows - batch, rows_per_block * thread_count);
+            const std::size_t blocks = (batch_rows + rows_per_block - 1) / rows_per_block;
+            detail::parallel_blocks(blocks, thread_count, 1, [&](const std::size_t first_block, const std::size_t last_block)
+            {
+                for (std::size_t block = first_block; block < last_block; ++block)
+                {
+                    const std::size_t first_row = batch + block * rows_per_block;
+                    const std::size_t last_row = std::min(first_row + rows_per_block, batch + batch_rows);
+                    std::vector<char>& buffer = buffers[block];
+                    buffer.resize((last_row - first_row) * line_capacity);
+                    char* out = buffer.data();
+                    for (std::size_t row = first_row; row < last_row; ++row)
+                        out = detail::format_tensor_row(out, tensor.values.data() + row * row_size, row_size, per_row ? &tensor.params[row] : nullptr);
+                    lengths[block] = static_cast<std::size_t>(out - buffer.data());
+                }
+            });
+            for (std::size_t block = 0; block < blocks && os; ++block)
+            {
+                INTEGRAL_IO_PROBE1(buffer_refill, lengths[block]);
+                os.write(buffers[block].data(), static_cast<std::streamsize>(lengths[block]));
+            }
+        }
+        INTEGRAL_IO_PROBE2(batch_end, rows, rows);
+        return os;
+    }
+
+    // Reads a whole tensor. Lines are read a batch at a time (about 4 MB per thread), and the rows in
+    //  each batch are parsed in parallel. Nothing beyond the tensor's last line is read. A thread
+    //  count of 0 means one per hardware thread. If anything is invalid, or the tensor is for the
+    //  other signedness, the stream's failbit is set.
+    template <typename Byte>
+    std::istream& read_tensor(std::istream& is, quantised_tensor<Byte>& tensor, const std::size_t threads = 0)
+    {
+        std::string line;
+        tensor_header header;
+        if (!detail::read_line(is, line) || !detail::parse_tensor_header(line, header) || header.is_signed != std::is_signed<Byte>::value)
+        {
+            is.setstate(std::ios_base::failbit);
+            return is;
+        }
+
+        const std::size_t rows = header.rows();
+        const std::size_t row_size = header.row_size();
+        const bool per_row = header.mode == quantisation::per_row;
+        tensor.shape = header.shape;
+        tensor.mode = header.mode;
+        try
+        {
+            tensor.params.assign(per_row ? rows : 1, header.params);
+            tensor.values.resize(rows * row_size);
+        }
+        catch (const std::exception&)
+        {
+            // The header asks for more memory than there is.
+            is.setstate(std::ios_base::failbit);
+            return is;
+        }
+        INTEGRAL_IO_PROBE1(batch_begin, rows);
+
+        const std::size_t thread_count = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        const std::size_t batch_size = thread_count << 22;
+        std::string batch;
+        std::vector<std::size_t> line_ends;
+        std::size_t row = 0;
+        while (row < rows)
+        {
+            batch.clear();
+            line_ends.clear();
+            while (row + line_ends.size() < rows && batch.size() < batch_size && detail::read_line(is, line))
+            {
+                batch += line;
+                line_ends.push_back(batch.size());
+                batch += '\n';
+            }
+            if (line_ends.empty())
+                break;
+            INTEGRAL_IO_PROBE1(buffer_refill, batch.size());
+
+            // Each block parses the rows whose newlines fall within it.
+            std::atomic<bool> failed{ false };
+            const char* const text = batch.data();
+            const auto is_newline = [](const char c) { return c == '\n'; };
+            detail::parallel_text_blocks(batch, true, thread_count, is_newline, [&](std::size_t, const std::string_view chunk)
+            {
+                const auto chunk_first = static_cast<std::size_t>(chunk.data() - text);
+                const std::size_t chunk_last = chunk_first + chunk.size();
+                auto i = static_cast<std::size_t>(std::lower_bound(line_ends.begin(), line_ends.end(), chunk_first) - line_ends.begin());
+                for (; i < line_ends.size() && line_ends[i] < chunk_last && !failed.load(std::memory_order_relaxed); ++i)
+                {
+                    const char* const first = text + (i == 0 ? 0 : line_ends[i - 1] + 1);
+                    const std::size_t r = row + i;
+                    if (!detail::parse_tensor_row(first, text + line_ends[i], tensor.values.data() + r * row_size, row_size, per_row ? &tensor.params[r] : nullptr))
+                        failed.store(true, std::memory_order_relaxed);
+                }
+            });
+            if (failed)
+                break;
+            row += line_ends.size();
+        }
+
+        if (row != rows)
+            is.setstate(std::ios_base::failbit);
+        INTEGRAL_IO_PROBE2(batch_end, row, rows);
+        return is;
+    }
+}
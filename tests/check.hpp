@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// A minimal checker for the test programs. Each program is built on its own (see the README), runs
+//  every check, reports the ones which fail, and exits with a failure status if any did.
+
+namespace integral_io_test
+{
+    inline int& failure_count()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline void check(const bool passed, const char* const condition, const char* const file, const int line)
+    {
+        if (passed)
+            return;
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+        ++failure_count();
+    }
+
+    inline int exit_status()
+    {
+        if (failure_count() == 0)
+            return EXIT_SUCCESS;
+        std::fprintf(stderr, "%d check(s) failed\n", failure_count());
+        return EXIT_FAILURE;
+    }
+}
+
+#define CHECK(condition) ::integral_io_test::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
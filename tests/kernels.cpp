@@ -0,0 +1,211 @@
+#include "check.hpp"
+
+#include "../integral_io.hpp"
+#include "../integral_io_mmap.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// Runs the same inputs through every kernel the CPU supports, switching with use_kernel(), and
+//  compares the results with the scalar kernel's. Setting INTEGRAL_IO_KERNEL only changes which
+//  kernel is active at startup; every supported one is still tested.
+
+namespace
+{
+    using namespace integral_io;
+
+    // Offsets of the first non-digit in runs of digits, at every length and alignment up to a few
+    //  vectors, with the characters either side of '0' to '9' and bytes with the top bit set.
+    std::vector<std::size_t> find_non_digit_results()
+    {
+        std::vector<std::size_t> results;
+        std::string text(300, '5');
+        for (const char stop : { '/', ':', ' ', '\0', static_cast<char>(0x80), static_cast<char>(0xB9) })
+        {
+            for (std::size_t offset = 0; offset < 8; ++offset)
+            {
+                for (std::size_t length = 0; length + offset < 200; ++length)
+                {
+                    text.assign(300, '7');
+                    text[offset + length] = stop;
+                    results.push_back(static_cast<std::size_t>(detail::find_non_digit(text.data() + offset, text.data() + 280) - text.data()));
+                }
+            }
+        }
+        return results;
+    }
+
+    std::vector<std::string> strict_texts()
+    {
+        std::mt19937 random(1);
+        std::vector<std::string> texts;
+        for (int i = 0; i < 2000; ++i)
+        {
+            std::string text;
+            const std::size_t tokens = random() % 20;
+            for (std::size_t token = 0; token < tokens; ++token)
+            {
+                if (random() % 4 == 0)
+                    text += '-';
+                text.append(random() % 40, static_cast<char>('0' + random() % 10));
+                text += random() % 8 == 0 ? '\n' : ' ';
+            }
+            // Break some of them somewhere.
+            if (!text.empty() && random() % 2 == 0)
+                text[random() % text.size()] = "x:/+ \n-"[random() % 7];
+            texts.push_back(text);
+        }
+        return texts;
+    }
+
+    std::vector<std::size_t> validate_strict_results(const std::vector<std::string>& texts)
+    {
+        std::vector<std::size_t> results;
+        for (const std::string& text : texts)
+            results.push_back(validate_strict(text));
+        return results;
+    }
+
+    // Swaps the bytes of integers starting at every alignment, in runs of every length up to a few
+    //  vectors.
+    template <typename Integer>
+    std::vector<Integer> swapped(const std::vector<unsigned char>& bytes)
+    {
+        std::vector<Integer> results;
+        for (std::size_t offset = 0; offset < sizeof(Integer) * 2; ++offset)
+        {
+            for (std::size_t count = 0; count < 70; ++count)
+            {
+                std::vector<Integer> out(count + 1, Integer{ 0x5A });
+                detail::copy_integers(bytes.data() + offset, count, true, out.data());
+                results.insert(results.end(), out.begin(), out.end());
+            }
+        }
+        return results;
+    }
+
+    template <typename Integer>
+    bool swaps_correctly(const std::vector<unsigned char>& bytes, const std::vector<Integer>& results)
+    {
+        std::size_t next = 0;
+        for (std::size_t offset = 0; offset < sizeof(Integer) * 2; ++offset)
+        {
+            for (std::size_t count = 0; count < 70; ++count)
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    Integer expected = 0;
+                    for (std::size_t b = 0; b < sizeof(Integer); ++b)
+                        expected = static_cast<Integer>(expected | static_cast<Integer>(bytes[offset + (i + 1) * sizeof(Integer) - 1 - b]) << (8 * b));
+                    if (results[next++] != expected)
+                        return false;
+                }
+                if (results[next++] != Integer{ 0x5A })
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Values of every length, including both limits, in runs which aren't a multiple of the batch
+    //  formatters' 8 values.
+    template <typename Integer>
+    std::vector<Integer> format_inputs()
+    {
+        std::mt19937_64 random(2);
+        std::vector<Integer> values{ 0, std::numeric_limits<Integer>::min(), std::numeric_limits<Integer>::max(), 1, static_cast<Integer>(-1) };
+        for (int i = 0; i < 5000; ++i)
+            values.push_back(static_cast<Integer>(random() >> (random() % 64)));
+        values.push_back(9);
+        return values;
+    }
+
+    template <typename Integer>
+    std::string expected_text(const std::vector<Integer>& values)
+    {
+        std::string text;
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            if (i != 0)
+                text += ' ';
+            if constexpr (std::is_signed<Integer>::value)
+                text += std::to_string(static_cast<long long>(values[i]));
+            else
+                text += std::to_string(static_cast<unsigned long long>(values[i]));
+        }
+        return text;
+    }
+
+    struct results
+    {
+        std::vector<std::size_t> find_non_digit;
+        std::vector<std::size_t> validate_strict;
+        std::vector<std::uint16_t> swapped16;
+        std::vector<std::uint32_t> swapped32;
+        std::vector<std::uint64_t> swapped64;
+        std::vector<std::string> formatted;
+
+        bool operator==(const results& other) const
+        {
+            return find_non_digit == other.find_non_digit && validate_strict == other.validate_strict && swapped16 == other.swapped16 &&
+                swapped32 == other.swapped32 && swapped64 == other.swapped64 && formatted == other.formatted;
+        }
+    };
+}
+
+int main()
+{
+    std::vector<unsigned char> bytes(sizeof(std::uint64_t) * 80);
+    for (std::size_t i = 0; i < bytes.size(); ++i)
+        bytes[i] = static_cast<unsigned char>(i * 37 + 11);
+    const std::vector<std::string> texts = strict_texts();
+    const auto i32 = format_inputs<std::int32_t>();
+    const auto u32 = format_inputs<std::uint32_t>();
+    const auto i64 = format_inputs<std::int64_t>();
+    const auto u64 = format_inputs<std::uint64_t>();
+
+    const auto run = [&]
+    {
+        results r;
+        r.find_non_digit = find_non_digit_results();
+        r.validate_strict = validate_strict_results(texts);
+        r.swapped16 = swapped<std::uint16_t>(bytes);
+        r.swapped32 = swapped<std::uint32_t>(bytes);
+        r.swapped64 = swapped<std::uint64_t>(bytes);
+        r.formatted = { to_string(i32), to_string(u32), to_string(i64), to_string(u64) };
+        return r;
+    };
+
+    const kernel initial = active_kernel();
+    std::printf("active kernel at startup: %s\n", kernel_name(initial));
+
+    CHECK(use_kernel(kernel::scalar) == kernel::scalar);
+    const results scalar = run();
+    CHECK(swaps_correctly(bytes, scalar.swapped16));
+    CHECK(swaps_correctly(bytes, scalar.swapped32));
+    CHECK(swaps_correctly(bytes, scalar.swapped64));
+    CHECK(scalar.formatted[0] == expected_text(i32));
+    CHECK(scalar.formatted[1] == expected_text(u32));
+    CHECK(scalar.formatted[2] == expected_text(i64));
+    CHECK(scalar.formatted[3] == expected_text(u64));
+
+    for (std::size_t k = 1; k < kernel_count; ++k)
+    {
+        const auto requested = static_cast<kernel>(k);
+        if (use_kernel(requested) != requested)
+        {
+            std::printf("%s: not supported, skipped\n", kernel_name(requested));
+            continue;
+        }
+        const bool same = run() == scalar;
+        CHECK(same);
+        std::printf("%s: %s\n", kernel_name(requested), same ? "matches scalar" : "DIFFERS from scalar");
+    }
+
+    use_kernel(initial);
+    return integral_io_test::exit_status();
+}
@@ -0,0 +1,84 @@
+#include "check.hpp"
+
+#include "../integral_io_netpbm.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace integral_io;
+
+    template <typename Sample>
+    bool reads(const std::string& text, netpbm_image<Sample>& image, const std::size_t threads = 0)
+    {
+        std::istringstream is(text);
+        read_netpbm(is, image, threads);
+        return !is.fail();
+    }
+
+    template <typename Sample>
+    void round_trip(const netpbm_format format, const unsigned maxval)
+    {
+        netpbm_image<Sample> image;
+        image.header.format = format;
+        image.header.width = 7;
+        image.header.height = 5;
+        image.header.maxval = maxval;
+        image.samples.resize(image.header.row_size() * image.header.height);
+        for (std::size_t i = 0; i < image.samples.size(); ++i)
+            image.samples[i] = static_cast<Sample>(i * 7919 % (maxval + 1));
+
+        std::ostringstream os;
+        write_netpbm(os, image);
+        CHECK(!os.fail());
+
+        netpbm_image<Sample> read;
+        CHECK(reads(os.str(), read, 3));
+        CHECK(read.header.format == format);
+        CHECK(read.header.width == 7 && read.header.height == 5 && read.header.maxval == maxval);
+        CHECK(read.samples == image.samples);
+    }
+
+    void invalid_images()
+    {
+        netpbm_image<std::uint8_t> image;
+        CHECK(reads("P2\n2 1\n255\n1 2\n", image));
+        CHECK(!reads("P2\n2 1\n255\n1\n", image));
+        CHECK(!reads("P2\n2 1\n255\n1 2 3\n", image));
+        CHECK(!reads("P2\n2 1\n100\n1 200\n", image));
+        CHECK(!reads("P2\n2 1\n255\n1 -\n", image));
+        CHECK(!reads("P5\n2 1\n255\nx", image));
+
+        netpbm_image<std::uint8_t> narrow;
+        CHECK(!reads("P2\n1 1\n65535\n1\n", narrow));
+    }
+
+    // A header's size isn't allocated up front, so claiming a huge image with hardly any samples
+    //  fails rather than running out of memory.
+    void huge_headers()
+    {
+        netpbm_image<std::uint8_t> image;
+        CHECK(!reads("P5\n100000 100000\n255\nabc", image));
+        CHECK(!reads("P6\n100000 100000\n255\nabc", image));
+        CHECK(!reads("P2\n100000 100000\n255\n1 2 3\n", image, 64));
+
+        netpbm_image<std::uint16_t> wide;
+        CHECK(!reads("P5\n100000 100000\n65535\nabcd", wide));
+    }
+}
+
+int main()
+{
+    round_trip<std::uint8_t>(netpbm_format::plain_pgm, 255);
+    round_trip<std::uint8_t>(netpbm_format::plain_ppm, 15);
+    round_trip<std::uint8_t>(netpbm_format::raw_pgm, 255);
+    round_trip<std::uint16_t>(netpbm_format::raw_pgm, 200);
+    round_trip<std::uint16_t>(netpbm_format::raw_ppm, 65535);
+    round_trip<std::uint16_t>(netpbm_format::plain_pgm, 1000);
+    invalid_images();
+    huge_headers();
+    return integral_io_test::exit_status();
+}
@@ -0,0 +1,132 @@
+#include "check.hpp"
+
+#include "../integral_io_npy.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace integral_io;
+
+    template <typename Integer>
+    void round_trip(const endian order)
+    {
+        const std::vector<Integer> values{ 0, 1, 2, 3, static_cast<Integer>(-1), 100, 127, 5, 6, 7, 8, 9 };
+        std::ostringstream os;
+        write_npy(os, values.data(), { 3, 4 }, order);
+        const std::string file = os.str();
+
+        const npy_array array(file.data(), file.size());
+        CHECK(array);
+        CHECK(array.holds<Integer>());
+        CHECK(array.size() == values.size());
+        const endian_span<Integer> read = array.values<Integer>();
+        CHECK(std::vector<Integer>(read.begin(), read.end()) == values);
+    }
+
+    // A 0-dimensional array holds one value, so a header with no data after it isn't valid.
+    void scalar_array()
+    {
+        std::ostringstream os;
+        const std::int64_t value = -42;
+        write_npy(os, &value, {});
+        const std::string file = os.str();
+
+        const npy_array array(file.data(), file.size());
+        CHECK(array);
+        CHECK(array.size() == 1);
+        CHECK(array.values<std::int64_t>()[0] == -42);
+
+        const std::string header_only = file.substr(0, file.size() - sizeof(value));
+        CHECK(!npy_array(header_only.data(), header_only.size()));
+        const std::string short_value = file.substr(0, file.size() - 1);
+        CHECK(!npy_array(short_value.data(), short_value.size()));
+    }
+
+    void truncated_values()
+    {
+        const std::vector<std::uint16_t> values(10, 7);
+        std::ostringstream os;
+        write_npy(os, values.data(), { 2, 5 });
+        const std::string file = os.str();
+        CHECK(npy_array(file.data(), file.size()));
+        CHECK(!npy_array(file.data(), file.size() - 1));
+
+        std::ostringstream empty;
+        write_npy(empty, values.data(), { 0, 5 });
+        const std::string empty_file = empty.str();
+        const npy_array empty_array(empty_file.data(), empty_file.size());
+        CHECK(empty_array);
+        CHECK(empty_array.size() == 0);
+    }
+
+    void text_round_trip()
+    {
+        const std::vector<std::int32_t> values{ 1, -2, 3, 40, -50, 60 };
+        std::ostringstream os;
+        write_npy(os, values.data(), { 2, 3 });
+        const std::string file = os.str();
+
+        std::ostringstream text;
+        write_npy_text(text, npy_array(file.data(), file.size()));
+        CHECK(text.str() == "1 -2 3\n40 -50 60\n");
+
+        std::istringstream is(text.str());
+        std::ostringstream npy;
+        read_npy_text<std::int32_t>(is, npy);
+        CHECK(!is.fail());
+        CHECK(npy.str() == file);
+    }
+
+    struct comma : default_policy
+    {
+        static constexpr char delimiter = ',';
+    };
+
+    struct strict_comma : strict
+    {
+        static constexpr char delimiter = ',';
+    };
+
+    // Text written with any delimiter reads back with the same policy.
+    template <typename Policy>
+    void delimited_round_trip()
+    {
+        const std::vector<std::int16_t> values{ 1, -2, 3, 40, -50, 60 };
+        std::ostringstream os;
+        write_npy(os, values.data(), { 2, 3 });
+        const std::string file = os.str();
+
+        std::ostringstream text;
+        write_npy_text<Policy>(text, npy_array(file.data(), file.size()));
+        CHECK(text.str() == "1,-2,3\n40,-50,60\n");
+
+        std::istringstream is(text.str());
+        std::ostringstream npy;
+        read_npy_text<std::int16_t, Policy>(is, npy);
+        CHECK(!is.fail());
+        CHECK(npy.str() == file);
+
+        std::istringstream missing_column("1,-2,3\n40,-50\n");
+        std::ostringstream ignored;
+        read_npy_text<std::int16_t, Policy>(missing_column, ignored);
+        CHECK(missing_column.fail());
+    }
+}
+
+int main()
+{
+    round_trip<std::int8_t>(endian::native);
+    round_trip<std::int16_t>(endian::big);
+    round_trip<std::uint32_t>(endian::little);
+    round_trip<std::int64_t>(endian::big);
+    scalar_array();
+    truncated_values();
+    text_round_trip();
+    delimited_round_trip<comma>();
+    delimited_round_trip<strict_comma>();
+    return integral_io_test::exit_status();
+}
@@ -0,0 +1,486 @@
+// integral-convert: converts binary files of integers to delimited text, and back.
+//
+// Build it with e.g.
+//
+//      g++ -std=c++17 -O2 -pthread -I. tools/integral_convert.cpp -o integral-convert
+//
+// Binary input is memory-mapped when it's a file. Both directions work on a few MB per thread at a
+//  time, which are formatted or parsed in parallel and then written in order, so files of any size
+//  can be converted, including through pipes.
+
+#include "integral_io.hpp"
+#include "integral_io_mmap.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#   include <fcntl.h>
+#   include <io.h>
+#endif
+
+namespace
+{
+    const char* const usage =
+        "Usage: integral-convert [options] [input [output]]\n"
+        "\n"
+        "Converts a binary file of integers to text, or text back to binary with --to-binary. The\n"
+        "input and output default to standard input and output, and - means the same.\n"
+        "\n"
+        "  -t, --type TYPE       i8, u8, i16, u16, i32, u32, i64 or u64 (default i32)\n"
+        "  -e, --endian ORDER    little, big or native (default native)\n"
+        "  -r, --radix N         2, 8, 10, 16, 36 or 62 (default 10)\n"
+        "  -s, --separator C     the character between values on a line (default space; \\t for a tab)\n"
+        "  -n, --per-line N      values per line of text, or 0 for one line (default 16)\n"
+        "  -j, --threads N       threads to use, or 0 for one per CPU (default 0)\n"
+        "  -b, --to-binary       convert text to binary; any whitespace also separates values, but\n"
+        "                        other separators can't leave a field empty\n"
+        "  -h, --help            show this help\n";
+
+    struct options
+    {
+        std::string type = "i32";
+        integral_io::endian order = integral_io::endian::native;
+        unsigned radix = 10;
+        char separator = ' ';
+        std::size_t per_line = 16;
+        std::size_t threads = 0;
+        bool to_binary = false;
+        std::string input = "-";
+        std::string output = "-";
+    };
+
+    [[noreturn]] void fail(const std::string& message, const int status = 1)
+    {
+        std::fprintf(stderr, "integral-convert: %s\n", message.c_str());
+        std::exit(status);
+    }
+
+    std::size_t parse_count(const std::string_view text, const char* const option)
+    {
+        const auto result = integral_io::parse<std::size_t, integral_io::strict>(text);
+        if (!result || result.consumed != text.size())
+            fail(std::string("invalid value for ") + option + ": " + std::string(text), 2);
+        return result.value;
+    }
+
+    options parse_options(const int argc, char** const argv)
+    {
+        options result;
+        std::vector<std::string> paths;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view arg = argv[i];
+            const auto value = [&]() -> std::string_view
+            {
+                if (i + 1 == argc)
+                    fail(std::string("missing value for ") + argv[i], 2);
+                return argv[++i];
+            };
+
+            if (arg == "-h" || arg == "--help")
+            {
+                std::fputs(usage, stdout);
+                std::exit(0);
+            }
+            else if (arg == "-t" || arg == "--type")
+            {
+                result.type = value();
+                static const char* const types[] = { "i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64" };
+                if (std::find(std::begin(types), std::end(types), result.type) == std::end(types))
+                    fail("unknown type: " + result.type, 2);
+            }
+            else if (arg == "-e" || arg == "--endian")
+            {
+                const std::string_view order = value();
+                if (order == "little")
+                    result.order = integral_io::endian::little;
+                else if (order == "big")
+                    result.order = integral_io::endian::big;
+                else if (order == "native")
+                    result.order = integral_io::endian::native;
+                else
+                    fail("unknown byte order: " + std::string(order), 2);
+            }
+            else if (arg == "-r" || arg == "--radix")
+            {
+                result.radix = static_cast<unsigned>(parse_count(value(), "--radix"));
+                if (result.radix != 2 && result.radix != 8 && result.radix != 10 && result.radix != 16 && result.radix != 36 && result.radix != 62)
+                    fail("unsupported radix: " + std::to_string(result.radix), 2);
+            }
+            else if (arg == "-s" || arg == "--separator")
+            {
+                const std::string_view separator = value();
+                if (separator == "\\t")
+                    result.separator = '\t';
+                else if (separator.size() == 1 && separator[0] != '\n' && separator[0] != '-' && (separator[0] < '0' || separator[0] > '9') &&
+                    (separator[0] < 'A' || separator[0] > 'Z') && (separator[0] < 'a' || separator[0] > 'z'))
+                    result.separator = separator[0];
+                else
+                    fail("the separator must be one character which can't be part of a value", 2);
+            }
+            else if (arg == "-n" || arg == "--per-line")
+            {
+                result.per_line = parse_count(value(), "--per-line");
+            }
+            else if (arg == "-j" || arg == "--threads")
+            {
+                result.threads = parse_count(value(), "--threads");
+            }
+            else if (arg == "-b" || arg == "--to-binary")
+            {
+                result.to_binary = true;
+            }
+            else if (arg.size() > 1 && arg[0] == '-')
+            {
+                fail("unknown option: " + std::string(arg), 2);
+            }
+            else
+            {
+                paths.emplace_back(arg);
+            }
+        }
+
+        if (paths.size() > 2)
+            fail("too many arguments", 2);
+        if (!paths.empty())
+            result.input = paths[0];
+        if (paths.size() == 2)
+            result.output = paths[1];
+        if (result.threads == 0)
+            result.threads = std::max(1u, std::thread::hardware_concurrency());
+        return result;
+    }
+
+    // The input, as a series of views: the whole file when it can be mapped, or otherwise a buffer
+    //  which is refilled from the stream.
+    class input_source
+    {
+    public:
+        explicit input_source(const std::string& path)
+        {
+            if (path == "-")
+            {
+                m_stream = stdin;
+#if defined(_WIN32)
+                _setmode(_fileno(stdin), _O_BINARY);
+#endif
+            }
+            else if (!m_file.open(path))
+            {
+                // Pipes and devices can't be mapped, but can still be read.
+                if (m_file.error() != std::errc::no_such_device || !(m_stream = std::fopen(path.c_str(), "rb")))
+                    fail("can't open " + path + ": " + m_file.error().message());
+            }
+        }
+
+        input_source(const input_source&) = delete;
+        input_source& operator=(const input_source&) = delete;
+
+        ~input_source()
+        {
+            if (m_stream && m_stream != stdin)
+                std::fclose(m_stream);
+        }
+
+        // Moves past the first used bytes of the last view, and returns a view of the next size
+        //  bytes (or fewer, at the end of the input). The view is valid until the next call.
+        std::string_view next(const std::size_t used, const std::size_t size)
+        {
+            if (!m_stream)
+            {
+                m_position += used;
+                const std::size_t available = std::min(size, m_file.size() - m_position);
+                return std::string_view(reinterpret_cast<const char*>(m_file.data()) + m_position, available);
+            }
+
+            m_buffer.erase(m_buffer.begin(), m_buffer.begin() + static_cast<std::ptrdiff_t>(used));
+            const std::size_t kept = m_buffer.size();
+            if (kept < size)
+            {
+                m_buffer.resize(size);
+                std::size_t filled = kept;
+                while (filled < size)
+                {
+                    const std::size_t read = std::fread(m_buffer.data() + filled, 1, size - filled, m_stream);
+                    if (read == 0)
+                        break;
+                    filled += read;
+                }
+                if (std::ferror(m_stream))
+                    fail("error reading the input");
+                m_buffer.resize(filled);
+            }
+            return std::string_view(m_buffer.data(), std::min(size, m_buffer.size()));
+        }
+
+    private:
+        integral_io::mapped_file m_file;
+        std::size_t m_position = 0;
+        std::FILE* m_stream = nullptr;
+        std::vector<char> m_buffer;
+    };
+
+    class output_sink
+    {
+    public:
+        explicit output_sink(const std::string& path)
+        {
+            if (path == "-")
+            {
+                m_stream = stdout;
+#if defined(_WIN32)
+                _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            }
+            else if (!(m_stream = std::fopen(path.c_str(), "wb")))
+            {
+                fail("can't create " + path + ": " + std::strerror(errno));
+            }
+        }
+
+        output_sink(const output_sink&) = delete;
+        output_sink& operator=(const output_sink&) = delete;
+
+        ~output_sink()
+        {
+            if (m_stream != stdout)
+                std::fclose(m_stream);
+        }
+
+        void write(const void* const data, const std::size_t size)
+        {
+            if (size != 0 && std::fwrite(data, 1, size, m_stream) != size)
+                fail("error writing the output");
+        }
+
+        void close()
+        {
+            if (std::fflush(m_stream) != 0 || (m_stream != stdout && std::fclose(m_stream) != 0))
+                fail("error writing the output");
+            m_stream = stdout;
+        }
+
+    private:
+        std::FILE* m_stream;
+    };
+
+    // Values are read in the stream grammar, so any whitespace separates them, and out-of-range
+    //  values fail rather than being clamped.
+    template <unsigned Radix>
+    struct convert_policy : integral_io::radix_policy<Radix>
+    {
+        static constexpr integral_io::overflow_mode overflow = integral_io::overflow_mode::fail_only;
+        static constexpr integral_io::output_table table = integral_io::output_table::bytes_and_shorts;
+    };
+
+    // Each thread converts about this many bytes of input at a time.
+    constexpr std::size_t block_size = std::size_t{ 4 } << 20;
+
+    // The last character of some text which isn't whitespace within a line, or the given one if
+    //  there isn't one.
+    char last_non_blank(const std::string_view text, const char otherwise)
+    {
+        for (std::size_t i = text.size(); i != 0; --i)
+        {
+            if (text[i - 1] == '\n' || !integral_io::detail::is_space(text[i - 1]))
+                return text[i - 1];
+        }
+        return otherwise;
+    }
+
+    template <typename Integer, typename Policy>
+    void binary_to_text(const options& options, input_source& input, output_sink& output)
+    {
+        using namespace integral_io;
+        constexpr std::size_t length = (detail::custom_format<Policy, Integer> ? detail::custom_format_length<Policy, integral_io_t<Integer>> : detail::max_decimal_length<integral_io_t<Integer>>) + 1;
+
+        // Blocks start at the start of a line, so that each knows where its lines end.
+        const std::size_t line = options.per_line != 0 ? options.per_line : 1;
+        const std::size_t block_values = std::max<std::size_t>(1, block_size / sizeof(Integer) / line) * line;
+        const std::size_t batch_values = block_values * options.threads;
+        std::vector<std::vector<Integer>> values(options.threads, std::vector<Integer>(block_values));
+        std::vector<std::vector<char>> text(options.threads, std::vector<char>(block_values * length + detail::format_slack));
+        std::vector<std::size_t> lengths(options.threads);
+
+        std::size_t total = 0;
+        std::string_view bytes = input.next(0, batch_values * sizeof(Integer));
+        while (bytes.size() >= sizeof(Integer))
+        {
+            const std::size_t count = bytes.size() / sizeof(Integer);
+            const std::size_t blocks = (count + block_values - 1) / block_values;
+            detail::parallel_blocks(blocks, options.threads, 1, [&](const std::size_t first_block, const std::size_t last_block)
+            {
+                for (std::size_t block = first_block; block < last_block; ++block)
+                {
+                    const std::size_t first = block * block_values;
+                    const std::size_t n = std::min(block_values, count - first);
+                    endian_span<Integer>(bytes.data() + first * sizeof(Integer), n, options.order).copy_to(values[block].data());
+
+                    char* const start = text[block].data();
+                    char* out = start;
+                    for (std::size_t i = 0; i < n; i += line)
+                    {
+                        out = detail::format_values<Policy, false>(out, values[block].data() + i, std::min(line, n - i));
+                        if (options.per_line != 0)
+                            out[-1] = '\n';
+                    }
+                    if (options.separator != ' ')
+                        std::replace(start, out, ' ', options.separator);
+                    lengths[block] = static_cast<std::size_t>(out - start);
+                }
+            });
+
+            total += count;
+            const std::string_view next = input.next(count * sizeof(Integer), batch_values * sizeof(Integer));
+            if (next.size() < sizeof(Integer))
+            {
+                // End the last line, rather than leaving a separator after the last value.
+                text[blocks - 1][lengths[blocks - 1] - 1] = '\n';
+            }
+            for (std::size_t block = 0; block < blocks; ++block)
+                output.write(text[block].data(), lengths[block]);
+            bytes = next;
+        }
+
+        if (!bytes.empty())
+            fail("the input ends with " + std::to_string(bytes.size()) + " bytes which aren't a whole value, after " + std::to_string(total) + " values");
+    }
+
+    template <typename Integer, typename Policy>
+    void text_to_binary(const options& options, input_source& input, output_sink& output)
+    {
+        using namespace integral_io;
+        const char separator = options.separator;
+        const auto is_boundary = [separator](const char c) { return c == separator || detail::is_space(c); };
+        // Whitespace can repeat, but any other separator must have a value on each side of it.
+        const bool whole_fields = separator != ' ' && !detail::is_space(separator);
+        char previous = '\n';
+        const std::size_t batch_size = block_size * options.threads;
+        std::vector<std::string> text(options.threads);
+        std::vector<std::vector<Integer>> values(options.threads);
+        std::vector<std::size_t> failures(options.threads);
+
+        std::size_t offset = 0;
+        std::string_view bytes = input.next(0, batch_size);
+        while (!bytes.empty())
+        {
+            const detail::text_blocks split = detail::parallel_text_blocks(bytes, bytes.size() < batch_size, options.threads, is_boundary, [&](const std::size_t block, std::string_view chunk)
+            {
+                const auto chunk_offset = static_cast<std::size_t>(chunk.data() - bytes.data());
+                std::size_t empty_field = std::string_view::npos;
+                if (whole_fields)
+                {
+                    // A separator after another or at the start of a line, or a line end after a
+                    //  separator, closes an empty field.
+                    char last = last_non_blank(bytes.substr(0, chunk_offset), previous);
+                    for (std::size_t i = 0; i < chunk.size(); ++i)
+                    {
+                        const char c = chunk[i];
+                        if (c == separator ? last == separator || last == '\n' : c == '\n' && last == separator)
+                        {
+                            empty_field = i;
+                            break;
+                        }
+                        if (c == '\n' || !detail::is_space(c))
+                            last = c;
+                    }
+                    text[block].assign(chunk.begin(), chunk.end());
+                    std::replace(text[block].begin(), text[block].end(), separator, ' ');
+                    chunk = text[block];
+                }
+
+                std::vector<Integer>& parsed = values[block];
+                parsed.resize(detail::count_tokens(chunk));
+                const bulk_parse_result result = parse<Policy>(chunk, parsed.data(), parsed.size());
+                const auto rest = std::find_if_not(chunk.begin() + static_cast<std::ptrdiff_t>(result.consumed), chunk.end(), detail::is_space);
+                failures[block] = empty_field != std::string_view::npos ? chunk_offset + empty_field : std::string_view::npos;
+                if (!result || rest != chunk.end())
+                {
+                    // Report where the bad value starts.
+                    std::size_t position = result ? static_cast<std::size_t>(rest - chunk.begin()) : std::min(result.consumed, chunk.size() - 1);
+                    while (position != 0 && !is_boundary(chunk[position - 1]))
+                        --position;
+                    failures[block] = std::min(failures[block], chunk_offset + position);
+                }
+                else if (failures[block] == std::string_view::npos && sizeof(Integer) != 1 && options.order != endian::native)
+                {
+                    // The vectorised byte swap works in place.
+                    detail::copy_integers(reinterpret_cast<const unsigned char*>(parsed.data()), parsed.size(), true, parsed.data());
+                }
+            });
+            if (split.blocks == 0)
+                fail("a value at offset " + std::to_string(offset) + " is too long");
+
+            for (std::size_t block = 0; block < split.blocks; ++block)
+            {
+                if (failures[block] != std::string_view::npos)
+                    fail("invalid or out-of-range value at offset " + std::to_string(offset + failures[block]));
+                output.write(values[block].data(), values[block].size() * sizeof(Integer));
+            }
+            if (whole_fields)
+                previous = last_non_blank(bytes.substr(0, split.end), previous);
+            offset += split.end;
+            bytes = input.next(split.end, batch_size);
+        }
+        // So does a separator at the very end of the text.
+        if (previous == separator)
+            fail("invalid or out-of-range value at offset " + std::to_string(offset));
+    }
+
+    template <typename Integer, typename Policy>
+    void convert(const options& options, input_source& input, output_sink& output)
+    {
+        if (options.to_binary)
+            text_to_binary<Integer, Policy>(options, input, output);
+        else
+            binary_to_text<Integer, Policy>(options, input, output);
+    }
+
+    template <typename Integer>
+    void convert(const options& options, input_source& input, output_sink& output)
+    {
+        switch (options.radix)
+        {
+        case 2: return convert<Integer, convert_policy<2>>(options, input, output);
+        case 8: return convert<Integer, convert_policy<8>>(options, input, output);
+        case 16: return convert<Integer, convert_policy<16>>(options, input, output);
+        case 36: return convert<Integer, convert_policy<36>>(options, input, output);
+        case 62: return convert<Integer, convert_policy<62>>(options, input, output);
+        default: return convert<Integer, convert_policy<10>>(options, input, output);
+        }
+    }
+}
+
+int main(const int argc, char** const argv)
+{
+    const options options = parse_options(argc, argv);
+    input_source input{ options.input };
+    output_sink output{ options.output };
+    if (options.type == "i8")
+        convert<std::int8_t>(options, input, output);
+    else if (options.type == "u8")
+        convert<std::uint8_t>(options, input, output);
+    else if (options.type == "i16")
+        convert<std::int16_t>(options, input, output);
+    else if (options.type == "u16")
+        convert<std::uint16_t>(options, input, output);
+    else if (options.type == "i32")
+        convert<std::int32_t>(options, input, output);
+    else if (options.type == "u32")
+        convert<std::uint32_t>(options, input, output);
+    else if (options.type == "i64")
+        convert<std::int64_t>(options, input, output);
+    else
+        convert<std::uint64_t>(options, input, output);
+    output.close();
+    return 0;
+}